@@ -1,21 +1,39 @@
 //
 //	Compiled with
 //	
-//	g++ main.cpp -std=c++17 -lsensors -lasound -o topbar
+//	g++ main.cpp -std=c++17 -lsensors -lasound -lz -o topbar
 //
 
-#include <iostream>
-#include <iomanip>
-#include <queue>
-#include <fstream>
-#include <sstream>
 #include <numeric>
 #include <thread>
 #include <chrono>
-#include <map>
 #include <vector>
 #include <string>
-#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+
+// For pressure stall triggers purpose
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// For pending updates purpose
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <zlib.h>
+
+// For batched collection purpose
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
 
 
 // For temperature measurements purpose
@@ -23,6 +41,221 @@
 
 #include <alsa/asoundlib.h>
 
+//
+//	Text helpers (small formatter and scanner, no iostreams)
+//
+namespace text
+{
+	// Buffered writer on a raw descriptor, formats floats as fixed point
+	struct writer
+	{
+		int fd;
+		int precision = 1;
+		std::string buffer;
+
+		writer& operator<<(const char* s) { buffer += s; return *this; }
+		writer& operator<<(const std::string& s) { buffer += s; return *this; }
+		writer& operator<<(char c) { buffer += c; return *this; }
+		writer& operator<<(bool b) { buffer += b ? '1' : '0'; return *this; }
+
+		template<typename T>
+		std::enable_if_t<std::is_integral_v<T>, writer&> operator<<(T value)
+		{
+			buffer += std::to_string(value);
+			return *this;
+		}
+
+		// Enums print as their underlying value, like iostreams did
+		template<typename T>
+		std::enable_if_t<std::is_enum_v<T>, writer&> operator<<(T value)
+		{
+			return *this << std::underlying_type_t<T>(value);
+		}
+
+		template<typename T>
+		std::enable_if_t<std::is_floating_point_v<T>, writer&> operator<<(T value)
+		{
+			char digits[64];
+			const int size = snprintf(digits, sizeof(digits), "%.*f", precision, double(value));
+			buffer.append(digits, std::min<size_t>(size, sizeof(digits) - 1));
+			return *this;
+		}
+
+		void flush()
+		{
+			for (size_t written = 0; written < buffer.size();)
+			{
+				const ssize_t size = write(fd, buffer.data() + written, buffer.size() - written);
+				if (size <= 0)
+					break;
+				written += size;
+			}
+			buffer.clear();
+		}
+	};
+
+	writer out{ STDOUT_FILENO };
+	writer err{ STDERR_FILENO };
+
+	// Forward-only cursor over raw file content
+	struct scanner
+	{
+		const char* cursor;
+		const char* end;
+
+		explicit scanner(const std::string& content) : cursor(content.data()), end(content.data() + content.size()) {}
+
+		bool done() const
+		{
+			return cursor >= end;
+		}
+
+		void skip_blanks()
+		{
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+				++cursor;
+		}
+
+		// Moves past next occurrence of c, false when there is none
+		bool skip_past(char c)
+		{
+			const void* found = std::memchr(cursor, c, end - cursor);
+			cursor = found ? static_cast<const char*>(found) + 1 : end;
+			return found;
+		}
+
+		void skip_line()
+		{
+			skip_past('\n');
+		}
+
+		// Reads digits after blanks, false when next token is not a number
+		bool next_u64(uint64_t& value)
+		{
+			skip_blanks();
+			if (cursor >= end || *cursor < '0' || *cursor > '9')
+				return false;
+
+			value = 0;
+			for (; cursor < end && *cursor >= '0' && *cursor <= '9'; ++cursor)
+				value = value * 10 + (*cursor - '0');
+
+			return true;
+		}
+
+		// Content comes from std::string, strtof stops at its null terminator
+		bool next_float(float& value)
+		{
+			char* parsed;
+			value = std::strtof(cursor, &parsed);
+			if (parsed == cursor)
+				return false;
+
+			cursor = std::min<const char*>(parsed, end);
+			return true;
+		}
+
+		// Reads next whitespace separated word
+		bool next_word(std::string& word)
+		{
+			while (cursor < end && isspace(static_cast<unsigned char>(*cursor)))
+				++cursor;
+
+			const char* start = cursor;
+			while (cursor < end && !isspace(static_cast<unsigned char>(*cursor)))
+				++cursor;
+
+			word.assign(start, cursor);
+			return cursor != start;
+		}
+
+		bool next_line(std::string& line)
+		{
+			if (cursor >= end)
+				return false;
+
+			const char* start = cursor;
+			skip_line();
+
+			line.assign(start, cursor - (cursor[-1] == '\n' ? 1 : 0));
+			return true;
+		}
+	};
+}
+
+//
+//	Filesystem helpers (raw syscalls, no std::filesystem)
+//
+namespace fs
+{
+	// Raw layout returned by getdents64
+	struct linux_dirent64
+	{
+		ino64_t d_ino;
+		off64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[];
+	};
+
+	/**
+	 * @brief lists directory entries with raw getdents64 calls
+	 * @param const char* path of directory
+	 * @param F callback receiving entry name and d_type
+	 * @return bool false when directory could not be opened
+	 */
+	template<typename F>
+	bool for_each_entry(const char* path, F on_entry)
+	{
+		const int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		alignas(linux_dirent64) char buffer[16 * 1024];
+
+		for (long size; (size = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0;)
+		{
+			for (long offset = 0; offset < size;)
+			{
+				const linux_dirent64* entry = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+				offset += entry->d_reclen;
+
+				if (std::strcmp(entry->d_name, ".") && std::strcmp(entry->d_name, ".."))
+					on_entry(entry->d_name, entry->d_type);
+			}
+		}
+
+		close(fd);
+		return true;
+	}
+
+	/**
+	 * @brief reads the whole content of a descriptor
+	 */
+	void read_all(int fd, std::string& content)
+	{
+		char buffer[4096];
+		for (ssize_t size; (size = ::read(fd, buffer, sizeof(buffer))) > 0; content.append(buffer, size));
+	}
+
+	/**
+	 * @brief reads the whole file
+	 * @return bool false when file could not be opened
+	 */
+	bool read_file(const char* path, std::string& content)
+	{
+		content.clear();
+
+		const int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		read_all(fd, content);
+		close(fd);
+		return true;
+	}
+}
+
 // Base log function implementation with simple parser
 void log(const char* s)
 {
@@ -30,9 +263,10 @@ void log(const char* s)
 	{
 		if (*s == '%')
 			++s;
-		std::cout << *s++;
+		text::out << *s++;
 	}
-	std::cout << std::endl;
+	text::out << '\n';
+	text::out.flush();
 }
 
 template<typename T, typename... Args>
@@ -45,11 +279,11 @@ void log(const char* s, T value, Args... args)
 			++s;
 			if (!(*(s) == '%'))
 			{
-				std::cout << value;
+				text::out << value;
 				log(s, args...); return;
 			}
 		}
-		std::cout << *s++;
+		text::out << *s++;
 	}
 }
 
@@ -77,783 +311,2902 @@ void log(const char* s, T value, Args... args)
 //	Globals
 //
 
-bool app_is_running = true;
+// Read by the updates worker thread too
+std::atomic<bool> app_is_running{true};
 
 //
-//	CPU Metrics
+//	Collection engine (batched reads of per-frame inputs)
 //
-
-namespace cpu
+namespace collect
 {
-	// For moving average of cpu metrics
-	const size_t SAMPLES = 5;
-	std::vector<float> metrics_queue;
+	struct slot
+	{
+		std::string path;
+		int fd;
+		std::vector<char> buffer;
 
-	// First overload to get real status from file
-	float get_cpu_metrics()
+		// Bytes read by last tick, -errno when it failed
+		ssize_t size = -1;
+	};
+
+	// Mapped io_uring rings
+	struct ring
 	{
-		// For delta calc purpose
-		static size_t previous_idle_time = 0, previous_total_time = 0;
+		int fd = -1;
+		unsigned entries = 0;
+
+		unsigned* sq_head;
+		unsigned* sq_tail;
+		unsigned* sq_mask;
+		unsigned* sq_array;
+		io_uring_sqe* sqes;
+
+		unsigned* cq_head;
+		unsigned* cq_tail;
+		unsigned* cq_mask;
+		io_uring_cqe* cqes;
+	};
 
-		// RAW cpu metrics
-		std::vector<size_t> cpu_times;
+	// Constants
+	const unsigned RING_ENTRIES = 64;
+	const size_t DEFAULT_BUFFER = 4096;
 
-		// File open scope
-		{
-			// Open cpu status file
-			std::ifstream proc_stat("/proc/stat");
+	// pread unless asked for, procfs and sysfs reads are punted to io_uring worker threads
+	bool use_uring = false;
+	ring uring;
 
-			// Skip "CPU  " string in first line
-			proc_stat.ignore(5, ' ');
+	std::vector<slot> slots;
 
-			// Store results in cpu_times vector as size_t
-			for (size_t time; proc_stat >> time; cpu_times.push_back(time));
-		}
+	// Syscalls issued by tick, for benchmark purpose
+	size_t syscalls = 0;
 
-		if (cpu_times.size() < 4)
-			return -1.0f;
+	bool setup_uring()
+	{
+		io_uring_params params{};
 
-		// Third metric is idle time of cpu
-		const size_t idle_time = cpu_times[3];
+		uring.fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+		if (uring.fd < 0)
+		{
+			LOG_WARN("io_uring unavailable, falling back to pread");
+			return false;
+		}
 
-		// Perform the sum of all elements in vector
-		const size_t total_time = std::accumulate(cpu_times.begin(), cpu_times.end(), 0);
+		const size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		const size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
 
-		// Perform delta times calc
-		const float idle_time_delta = idle_time - previous_idle_time;
-		const float total_time_delta = total_time - previous_total_time;
+		char* sq = static_cast<char*>(mmap(nullptr, single_mmap ? std::max(sq_size, cq_size) : sq_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQ_RING));
+		char* cq = single_mmap ? sq : static_cast<char*>(mmap(nullptr, cq_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_CQ_RING));
+		void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQES);
 
-		// Update static states of function
-		previous_idle_time = idle_time;
-		previous_total_time = total_time;
+		if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED)
+		{
+			LOG_WARN("Failed to map io_uring rings, falling back to pread");
+			close(uring.fd);
+			uring.fd = -1;
+			return false;
+		}
 
-		// Update metrics queue using certain amount of samples
-		if (metrics_queue.size() >= SAMPLES)
-			metrics_queue.erase(metrics_queue.begin());
+		uring.entries = params.sq_entries;
+		uring.sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		uring.sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		uring.sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		uring.sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		uring.sqes = static_cast<io_uring_sqe*>(sqes);
 
-		metrics_queue.push_back(float{ 100.0f * (1.0f - idle_time_delta / total_time_delta) });
+		uring.cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		uring.cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		uring.cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		uring.cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
 
-		// Get cpu utilization in percent
-		return float { 
-			std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size()) 
-		};
+		LOG_INFO("io_uring collection engine ready, % entries", uring.entries);
+		return true;
 	}
-}
 
-//
-//	GPU Metrics
-//
+	void init_collect(bool try_uring)
+	{
+		use_uring = try_uring && setup_uring();
+	}
 
-//
-//	RAM Metrics
-//
+	// Few files are watched, a linear search beats a map here
+	std::vector<slot>::iterator find_slot(const std::string& path)
+	{
+		return std::find_if(slots.begin(), slots.end(), [&path](const slot& s) { return s.path == path; });
+	}
 
-namespace ram
-{
-	struct status
+	/**
+	 * @brief registers a file read every frame, keeping its descriptor open
+	 * @param std::string path of file
+	 * @param size_t initial buffer size, grows when content does not fit
+	 */
+	void watch(const std::string& path, size_t buffer_size = DEFAULT_BUFFER)
 	{
-		float used;
-		float total;
-		float percent;
-	};
+		if (find_slot(path) != slots.end())
+			return;
 
-	// Constants
-	const size_t METRICS_NUMBER = 53;
-	const float KB_TO_GB = 1.0f / 1048576.0f;
+		const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			LOG_WARN("Failed to watch file: %", path);
+			return;
+		}
 
-	// For moving average of RAM metrics
-	const size_t SAMPLES = 5;
-	std::vector<float> metrics_queue;
+		slots.push_back({ path, fd, std::vector<char>(buffer_size) });
+	}
 
-	// First overload to get real status from file
-	status get_ram_metrics()
+	// Completes a read that filled its buffer, growing it for next ticks
+	void finish_read(slot& s)
 	{
-		std::vector<float> ram_metrics;
-		ram_metrics.reserve(METRICS_NUMBER);
-
-		// File open scope
+		while (s.size == ssize_t(s.buffer.size()))
 		{
-			// Open memory status file
-			std::ifstream mem_info("/proc/meminfo");
+			s.buffer.resize(s.buffer.size() * 2);
 
-			// Lambda to process values from file
-			auto process_line = [&mem_info](float& metric) -> bool {
-				mem_info.ignore(256, ':');
-				return mem_info >> metric ? true : false;
-			};
+			const ssize_t size = pread(s.fd, s.buffer.data() + s.size, s.buffer.size() - s.size, s.size);
+			++syscalls;
 
-			// Extract all metrics from meminfo
-			for (float metric; process_line(metric); ram_metrics.push_back(metric));
-		}
+			if (size <= 0)
+				break;
 
-		// Position of MemTotal
-		const float mem_total = ram_metrics[0];
-		// Position of MemFree
-		const float mem_free = ram_metrics[1];
-		// Position of Buffers
-		const float mem_buffer = ram_metrics[3];
-		// Position of Cached:
-		const float mem_cached = ram_metrics[4];
-		// Position of SReclaimable
-		const float mem_sreclaimable = ram_metrics[23];
+			s.size += size;
+		}
+	}
 
-		// Calculates used memory of system
-		const float mem_used = mem_total - mem_free - mem_buffer - mem_cached - mem_sreclaimable;
-		
-		// Update metrics queue using certain amount of samples
-		if (metrics_queue.size() >= SAMPLES)
-			metrics_queue.erase(metrics_queue.begin());
+	void read_slot(slot& s)
+	{
+		s.size = pread(s.fd, s.buffer.data(), s.buffer.size(), 0);
+		++syscalls;
 
-		metrics_queue.push_back(mem_used);
+		if (s.size < 0)
+			s.size = -errno;
+	}
 
-		const float mem_used_avg = std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size());
-		const float mem_used_percent_avg = (mem_used_avg / mem_total) * 100.0f;
+	// Recreated files (restarted service cgroups, replugged supplies) leave the old descriptor stale
+	void reopen_stale(slot& s)
+	{
+		if (s.size != -ENODEV && s.size != -ENOENT)
+			return;
+
+		// Still gone files keep the old descriptor and are retried next tick
+		const int fd = open(s.path.c_str(), O_RDONLY | O_CLOEXEC);
+		++syscalls;
+		if (fd < 0)
+			return;
+
+		LOG_INFO("Reopened recreated file: %", s.path);
+		close(s.fd);
+		s.fd = fd;
+		read_slot(s);
+	}
 
-		// Get ram status
-		return status { 
-			mem_used_avg * KB_TO_GB,
-			mem_total * KB_TO_GB,
-			mem_used_percent_avg
-		};
+	void tick_pread()
+	{
+		for (slot& s : slots)
+			read_slot(s);
 	}
-}
 
-//
-//	TEMP Metrics
-//
-namespace temp
-{
-	// Temperature chip data
-	const sensors_chip_name* cpu_chip_name = nullptr;
-	const sensors_subfeature* cpu_sub_feature = nullptr;
+	void tick_uring()
+	{
+		for (size_t first = 0; first < slots.size(); first += uring.entries)
+		{
+			const size_t count = std::min<size_t>(uring.entries, slots.size() - first);
 
-	// Temperature sensors types
-	const std::string sensor_types = "coretemp via_cputemp cpu_thermal k10temp zenpower acpitz";
+			unsigned tail = *uring.sq_tail;
+			for (size_t i = first; i < first + count; ++i, ++tail)
+			{
+				const unsigned index = tail & *uring.sq_mask;
+
+				io_uring_sqe* sqe = &uring.sqes[index];
+				std::memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode = IORING_OP_READ;
+				sqe->fd = slots[i].fd;
+				sqe->addr = reinterpret_cast<uint64_t>(slots[i].buffer.data());
+				sqe->len = slots[i].buffer.size();
+				sqe->off = 0;
+				sqe->user_data = i;
+
+				uring.sq_array[index] = index;
+			}
+			__atomic_store_n(uring.sq_tail, tail, __ATOMIC_RELEASE);
 
-	void init_sensors()
-	{
-		if (!sensors_init(NULL))
-			LOG_INFO("Successful initialized libsensor");
-		else
-			LOG_ERROR("Failed to initialize libsensor");
+			// Every read of the batch is submitted and reaped in one call
+			const int submitted = syscall(__NR_io_uring_enter, uring.fd, count, count, IORING_ENTER_GETEVENTS, nullptr, 0);
+			++syscalls;
 
-		int nr = 0;
-		for (const sensors_chip_name* chip = sensors_get_detected_chips(NULL, &nr); chip; chip = sensors_get_detected_chips(0, &nr))
-		{
-			if (sensor_types.find(std::string(chip->prefix)) != std::string::npos)
+			if (submitted < 0)
 			{
-				LOG_INFO("Found temperature sensor, prefix: %, path: %", chip->prefix, chip->path);
-				int ft = 0;
-				for (const sensors_feature* feature = sensors_get_features(chip, &ft); feature; sensors_get_features(chip, &ft))
-				{
-					if (std::string(feature->name).find("temp1") != std::string::npos)
-					{
-						LOG_INFO("Found temperature sensor feature: %", feature->name);
+				LOG_WARN("io_uring_enter failed, falling back to pread");
+				use_uring = false;
+				tick_pread();
+				return;
+			}
 
-						cpu_chip_name = chip;
-						cpu_sub_feature = sensors_get_subfeature(chip, feature, SENSORS_SUBFEATURE_TEMP_INPUT);
+			unsigned head = *uring.cq_head;
+			for (; head != __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE); ++head)
+			{
+				const io_uring_cqe& cqe = uring.cqes[head & *uring.cq_mask];
+				slot& s = slots[cqe.user_data];
 
-						LOG_INFO("Selected sensor subfeature: % / type: %", cpu_sub_feature->name, cpu_sub_feature->type);
-						break;
-					}
+				// Kernels without IORING_OP_READ reject the opcode
+				if (cqe.res == -EINVAL)
+				{
+					read_slot(s);
+					use_uring = false;
 				}
-				break;
+				else
+					s.size = cqe.res;
 			}
+			__atomic_store_n(uring.cq_head, head, __ATOMIC_RELEASE);
 		}
 	}
 
-	// For moving average of TEMP metrics
-	const size_t SAMPLES = 1;
-	std::vector<float> metrics_queue;
-
-	float get_cpu_temperature_metrics()
+	/**
+	 * @brief reads every watched file for this frame
+	 */
+	void tick()
 	{
-		double temperature;
-		sensors_get_value(cpu_chip_name, cpu_sub_feature->number, &temperature);
+		if (use_uring)
+			tick_uring();
+		else
+			tick_pread();
 
-		// Update metrics queue using certain amount of samples
-		if (metrics_queue.size() >= SAMPLES)
-			metrics_queue.erase(metrics_queue.begin());
+		for (slot& s : slots)
+		{
+			reopen_stale(s);
+			finish_read(s);
+		}
+	}
 
-		metrics_queue.push_back(temperature);
-	
-		return std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size());
+	/**
+	 * @brief gets the content read by the last tick
+	 * @param std::string path of file
+	 * @param std::string& receives file content
+	 * @param bool& false when last read failed
+	 * @return bool false when file is not watched
+	 */
+	bool lookup(const std::string& path, std::string& content, bool& found)
+	{
+		auto s = find_slot(path);
+		if (s == slots.end())
+			return false;
+
+		found = s->size >= 0;
+		content.assign(s->buffer.data(), found ? s->size : 0);
+		return true;
+	}
+
+	/**
+	 * @brief compares both backends over the watched files
+	 * @param size_t number of ticks per backend
+	 */
+	void benchmark(size_t ticks)
+	{
+		const bool uring_available = use_uring;
+
+		for (const bool uring_backend : { true, false })
+		{
+			if (uring_backend && !uring_available)
+			{
+				text::err << "io_uring: unavailable\n";
+				text::err.flush();
+				continue;
+			}
+
+			use_uring = uring_backend;
+			syscalls = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < ticks; ++i)
+				tick();
+			const std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+			text::err << (uring_backend ? "io_uring" : "pread") << ": " << slots.size() << " files, "
+					  << float(syscalls) / ticks << " syscalls/tick, "
+					  << elapsed.count() / ticks << " us/tick\n";
+			text::err.flush();
+		}
+
+		use_uring = uring_available;
 	}
 }
 
 //
-//	BATTERY Metrics
+//	Capture (record / replay of raw collector inputs)
 //
-namespace battery
+namespace capture
 {
-	typedef struct
-	{
-		float power_now;
-		float energy_now;  // in Wh
-		float energy_full; // in Wh
-	} energy_t;
+	enum class mode { live, record, replay };
 
-	struct status
+	// Log layout: magic, then records [u8 type][u16 key size][key]([u32 data size][data])
+	// with a FRAME record [u8 type][u64 ns since start] closing every frame.
+	// Options that change what is read lead the first frame as "option:<name>" records
+	enum record_type : uint8_t { FRAME = 0, DATA = 1, MISSING = 2 };
+
+	const char MAGIC[8] = { 'T', 'B', 'C', 'A', 'P', '0', '0', '2' };
+
+	mode current_mode = mode::live;
+	bool realtime = false;
+
+	struct entry
 	{
-		int capacity;
-		bool charging;
-		std::string remaining_time;
+		std::string key;
+		bool found;
+		std::string data;
+		bool taken = false;
 	};
 
-	// Constants
-	const char *POWER_SUPPLIES_DIR = "/sys/class/power_supply/";
-	const char *BATTERY_PREFIX = "BAT";
-	
-	// Supplies path
-	const std::filesystem::path power_supplies{POWER_SUPPLIES_DIR};
+	// Records of current frame, written at frame end
+	int record_fd = -1;
+	std::string record_buffer;
 
-	// Supplies storages
-	std::map<int, std::vector<std::string>> batteries;
+	// Whole replayed log and read position
+	std::string replay_data;
+	size_t replay_offset = 0;
 
-	bool has_battery()
+	std::chrono::steady_clock::time_point start_time;
+	size_t frames = 0;
+
+	// Entries of the frame being replayed, consumed in recorded order per key
+	std::vector<entry> frame_entries;
+
+	bool replaying()
 	{
-		return !std::filesystem::is_empty(power_supplies);
+		return current_mode == mode::replay;
 	}
 
-	void check_supplies()
+	template<typename T>
+	void write_raw(const T& value)
+	{
+		record_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	bool read_bytes(void* data, size_t size)
+	{
+		if (replay_data.size() - replay_offset < size)
+			return false;
+
+		std::memcpy(data, replay_data.data() + replay_offset, size);
+		replay_offset += size;
+		return true;
+	}
+
+	template<typename T>
+	bool read_raw(T& value)
+	{
+		return read_bytes(&value, sizeof(T));
+	}
+
+	void append(record_type type, const std::string& key, const std::string& data)
+	{
+		write_raw(uint8_t(type));
+		write_raw(uint16_t(key.size()));
+		record_buffer += key;
+
+		if (type == DATA)
+		{
+			write_raw(uint32_t(data.size()));
+			record_buffer += data;
+		}
+	}
+
+	bool take(const std::string& key, std::string& data)
 	{
-		for (const auto &entry : std::filesystem::directory_iterator(power_supplies))
+		auto recorded = std::find_if(frame_entries.begin(), frame_entries.end(), [&key](const entry& e) {
+			return !e.taken && e.key == key;
+		});
+
+		// Parsers would run on input that was never recorded, nothing after this is faithful
+		if (recorded == frame_entries.end())
 		{
-			std::string entry_path = entry.path().string();
+			text::err << "Replay log has no entry for " << key << " in frame " << frames
+				<< ", it was recorded by another build\n";
+			text::err.flush();
+			std::exit(1);
+		}
 
-			size_t bat_search = entry_path.find(BATTERY_PREFIX);
+		recorded->taken = true;
+		data = std::move(recorded->data);
+		return recorded->found;
+	}
 
-			if (bat_search != std::string::npos)
-			{
-				// Generates stream for value extraction
-				std::stringstream ss(entry_path);
-				ss.ignore(bat_search, '\0');
+	// Loads every entry up to the next frame marker, false when the log ends
+	bool load_frame()
+	{
+		frame_entries.clear();
 
-				// Get number of battery
-				int index;
-				ss >> index;
+		for (uint8_t type; read_raw(type);)
+		{
+			if (type == FRAME)
+			{
+				uint64_t timestamp;
+				if (!read_raw(timestamp))
+					return false;
 
-				ss.clear();
-				ss.str(std::string());
-				ss << entry_path << "/capacity";
-				std::string capacity_path = ss.str();
+				if (realtime)
+					std::this_thread::sleep_until(start_time + std::chrono::nanoseconds(timestamp));
 
-				ss.clear();
-				ss.str(std::string());
-				ss << entry_path << "/status";
-				std::string status_path = ss.str();
+				return true;
+			}
 
-				ss.clear();
-				ss.str(std::string());
-				ss << entry_path << "/power_now";
-				std::string power_now_path = ss.str();
+			uint16_t key_size;
+			if (!read_raw(key_size))
+				return false;
 
-				ss.clear();
-				ss.str(std::string());
-				ss << entry_path << "/energy_now";
-				std::string energy_now_path = ss.str();
+			std::string key(key_size, '\0');
+			if (!read_bytes(key.data(), key_size))
+				return false;
 
-				ss.clear();
-				ss.str(std::string());
-				ss << entry_path << "/energy_full";
-				std::string energy_full_path = ss.str();
+			std::string data;
+			if (type == DATA)
+			{
+				uint32_t data_size;
+				if (!read_raw(data_size))
+					return false;
 
-				batteries[index] = {capacity_path, status_path, power_now_path,
-									energy_now_path, energy_full_path};
+				data.resize(data_size);
+				if (!read_bytes(data.data(), data_size))
+					return false;
 			}
+
+			frame_entries.push_back({ std::move(key), type == DATA, std::move(data) });
 		}
-			}
 
-	typedef struct
+		return false;
+	}
+
+	bool start_record(const char* path)
 	{
-		unsigned int last_value_index;
-		const size_t samples;
-		std::vector<float> values = std::vector<float>(samples);
-		float avg = 0;
-	} circular_buffer_t;
+		record_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (record_fd < 0)
+			return false;
+
+		record_buffer.assign(MAGIC, sizeof(MAGIC));
+		current_mode = mode::record;
+		start_time = std::chrono::steady_clock::now();
+		return true;
+	}
 
-	void clear_circular_buffer(circular_buffer_t *buff, float value)
+	bool start_replay(const char* path)
 	{
-		for (int i = 0; i < buff->samples; ++i)
+		if (!fs::read_file(path, replay_data))
+			return false;
+
+		char magic[sizeof(MAGIC)] = {};
+		if (!read_bytes(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC))
+			return false;
+
+		current_mode = mode::replay;
+		start_time = std::chrono::steady_clock::now();
+
+		// Startup discovery and first frame share the first group of entries
+		return load_frame();
+	}
+
+	/**
+	 * @brief closes the current frame, loading the next one when replaying
+	 * @return bool false when the replayed log has no more frames
+	 */
+	bool next_frame()
+	{
+		++frames;
+
+		switch (current_mode)
 		{
-			buff->values[i] = value;
-			buff->avg = value * buff->samples;
+		case mode::record:
+			write_raw(uint8_t(FRAME));
+			write_raw(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count()));
+			for (size_t written = 0; written < record_buffer.size();)
+			{
+				const ssize_t size = write(record_fd, record_buffer.data() + written, record_buffer.size() - written);
+				if (size <= 0)
+					break;
+				written += size;
+			}
+			record_buffer.clear();
+			return true;
+		case mode::replay:
+			return load_frame();
+		default:
+			return true;
 		}
 	}
 
-	float moving_average(circular_buffer_t *buff, float value)
+	/**
+	 * @brief reads the whole file, recording or replaying its raw bytes
+	 * @param std::string path of file
+	 * @param std::string& receives file content, empty when missing
+	 * @return bool false when file could not be opened
+	 */
+	bool read(const std::string& path, std::string& content)
 	{
-		if (++buff->last_value_index >= buff->samples)
-			buff->last_value_index = 0;
+		if (replaying())
+			return take(path, content);
 
-		buff->avg -= buff->values[buff->last_value_index];
-		buff->values[buff->last_value_index] = value;
-		buff->avg += value;
-		return buff->avg / buff->samples;
+		bool found;
+
+		// Watched files were already read by this frame tick
+		if (!collect::lookup(path, content, found))
+			found = fs::read_file(path.c_str(), content);
+
+		if (current_mode == mode::record)
+			append(found ? DATA : MISSING, path, content);
+
+		return found;
+	}
+
+	std::string read(const std::string& path)
+	{
+		std::string content;
+		read(path, content);
+		return content;
+	}
+
+	/**
+	 * @brief lists directory entries as full paths, recording or replaying them
+	 * @param std::string path of directory
+	 * @return std::vector<std::string> entries, empty when directory is missing
+	 */
+	std::vector<std::string> list(const std::string& dir)
+	{
+		const std::string key = "dir:" + dir;
+		std::string joined;
+
+		if (replaying())
+			take(key, joined);
+		else
+		{
+			fs::for_each_entry(dir.c_str(), [&joined, &dir](const char* name, unsigned char) {
+				joined += dir;
+				if (!dir.empty() && dir.back() != '/')
+					joined += '/';
+				joined += name;
+				joined += '\n';
+			});
+
+			if (current_mode == mode::record)
+				append(DATA, key, joined);
 		}
 
-	std::string get_battery_time(energy_t *energy, bool charging)
+		std::vector<std::string> entries;
+		text::scanner ss(joined);
+		for (std::string entry; ss.next_line(entry); entries.push_back(entry));
+
+		return entries;
+	}
+
+	/**
+	 * @brief records an option that changes what is read, replays run with the recorded one
+	 * @param std::string option name
+	 * @param std::vector<std::string>& values given on the command line, replaced when replaying
+	 */
+	void option(const std::string& name, std::vector<std::string>& values)
 	{
+		if (current_mode == mode::live)
+			return;
 
-		static circular_buffer_t remaining_time = {
-			.last_value_index = 0,
-			.samples = 50};
+		const std::string key = "option:" + name;
+		std::string joined;
 
-		static bool was_charging = charging;
+		if (replaying())
+		{
+			take(key, joined);
 
-		if (energy->power_now == 0)
-			return ("0:00");
+			values.clear();
+			text::scanner lines(joined);
+			for (std::string value; lines.next_line(value); values.push_back(value));
+			return;
+		}
 
-		if (was_charging != charging)
+		for (const std::string& value : values)
+			joined += value + '\n';
+
+		append(DATA, key, joined);
+	}
+
+	/**
+	 * @brief records raw values read from a library, or overwrites them when replaying
+	 * @param std::string key identifying the values
+	 * @param Args&... trivially copyable values
+	 */
+	template<typename... Args>
+	void values(const std::string& key, Args&... args)
+	{
+		static_assert((std::is_trivially_copyable_v<Args> && ...));
+
+		if (current_mode == mode::live)
+			return;
+
+		std::string data;
+
+		if (replaying())
 		{
-			was_charging = charging;
-			clear_circular_buffer(&remaining_time, (charging ? energy->energy_full : energy->energy_now) / energy->power_now);
+			if (!take(key, data) || data.size() != (sizeof(Args) + ...))
+				return;
+
+			const char* cursor = data.data();
+			((std::memcpy(&args, cursor, sizeof(Args)), cursor += sizeof(Args)), ...);
+			return;
 		}
 
-		float remaining_time_f = moving_average(&remaining_time,
-												(charging ? energy->energy_full : energy->energy_now) / energy->power_now);
+		(data.append(reinterpret_cast<const char*>(&args), sizeof(Args)), ...);
+		append(DATA, key, data);
+	}
 
-		int hours = remaining_time_f;
-		int mins = (remaining_time_f - hours) * 60;
+	void report()
+	{
+		if (!replaying())
+			return;
 
-		return std::to_string(hours) + ":" + (mins < 10 ? "0" : "") + std::to_string(mins);
+		const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
+		text::err << frames << " frames in " << seconds << " s (" << frames / seconds << " fps)\n";
+		text::err.flush();
 	}
+}
 
-	status get_battery_metrics()
+//
+//	CPU Metrics
+//
+
+namespace cpu
+{
+	// For moving average of cpu metrics
+	const size_t SAMPLES = 5;
+	std::vector<float> metrics_queue;
+
+	// First overload to get real status from file
+	float get_cpu_metrics()
 	{
-		const float energy_coeff = 1 / 1e6;
-		const float power_coeff = 1 / 1e6;
-		std::ifstream capacity_file(batteries.at(0)[0]);
-		std::ifstream status_file(batteries.at(0)[1]);
-		std::ifstream power_now_file(batteries.at(0)[2]);
-		std::ifstream energy_now_file(batteries.at(0)[3]);
-		std::ifstream energy_full_file(batteries.at(0)[4]);
+		// For delta calc purpose
+		static size_t previous_idle_time = 0, previous_total_time = 0;
 
-		int battery_value;
-		capacity_file >> battery_value;
+		// RAW cpu metrics
+		std::vector<size_t> cpu_times;
 
-		std::string battery_status;
-		status_file >> battery_status;
-		bool charging = (battery_status != "Discharging");
+		// File open scope
+		{
+			// Open cpu status file
+			const std::string content = capture::read("/proc/stat");
+			text::scanner proc_stat(content);
 
-		energy_t energy;
+			// Skip "CPU  " string in first line
+			proc_stat.skip_past(' ');
 
-		power_now_file >> energy.power_now;
-		energy.power_now *= power_coeff;
+			// Store results in cpu_times vector as size_t
+			for (uint64_t time; proc_stat.next_u64(time); cpu_times.push_back(time));
+		}
 
-		energy_now_file >> energy.energy_now;
-		energy.energy_now *= energy_coeff;
+		if (cpu_times.size() < 4)
+			return -1.0f;
 
-		energy_full_file >> energy.energy_full;
-		energy.energy_full *= energy_coeff;
+		// Third metric is idle time of cpu
+		const size_t idle_time = cpu_times[3];
 
-		std::string remaining_time = get_battery_time(&energy, charging);
+		// Perform the sum of all elements in vector
+		const size_t total_time = std::accumulate(cpu_times.begin(), cpu_times.end(), 0);
 
-		return status{
-			battery_value,
-			charging,
-			remaining_time,
+		// Perform delta times calc
+		const float idle_time_delta = idle_time - previous_idle_time;
+		const float total_time_delta = total_time - previous_total_time;
+
+		// Update static states of function
+		previous_idle_time = idle_time;
+		previous_total_time = total_time;
+
+		// Update metrics queue using certain amount of samples
+		if (metrics_queue.size() >= SAMPLES)
+			metrics_queue.erase(metrics_queue.begin());
+
+		metrics_queue.push_back(float{ 100.0f * (1.0f - idle_time_delta / total_time_delta) });
+
+		// Get cpu utilization in percent
+		return float { 
+			std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size()) 
 		};
 	}
 }
 
 //
-//	POWER Metrics
+//	GPU Metrics
 //
 
 //
-//	VOL Metrics
+//	RAM Metrics
 //
-namespace audio
-{
-	// Volume configs
-	const char* volume_card = "default";
-	const char* volume_mixer_name = "Master";
-	const int volume_mixer_index = 0;
-
-	snd_mixer_t* volume_handle;
-	snd_mixer_elem_t* volume_element;
-	snd_mixer_selem_id_t* volume_sid;
-
-	// Mic configs
-	const char* mic_card = "default";
-	const char* mic_mixer_name = "Capture";
-	const int mic_mixer_index = 0;
-
-	snd_mixer_t* mic_handle;
-	snd_mixer_elem_t* mic_element;
-	snd_mixer_selem_id_t* mic_sid;
 
+namespace ram
+{
 	struct status
 	{
-		long volume;
-		bool is_active;
+		float used;
+		float total;
+		float percent;
 	};
 
-	void init_connection(
-		const char* card, const char* mixer_name, const int mixer_index,
-		snd_mixer_t** handle, snd_mixer_elem_t** element, snd_mixer_selem_id_t** sid
-	)
+	// Constants
+	const size_t METRICS_NUMBER = 53;
+	const float KB_TO_GB = 1.0f / 1048576.0f;
+
+	// For moving average of RAM metrics
+	const size_t SAMPLES = 5;
+	std::vector<float> metrics_queue;
+
+	// First overload to get real status from file
+	status get_ram_metrics()
+	{
+		std::vector<float> ram_metrics;
+		ram_metrics.reserve(METRICS_NUMBER);
+
+		// File open scope
+		{
+			// Open memory status file
+			const std::string content = capture::read("/proc/meminfo");
+			text::scanner mem_info(content);
+
+			// Lambda to process values from file
+			auto process_line = [&mem_info](float& metric) -> bool {
+				uint64_t value;
+				if (!mem_info.skip_past(':') || !mem_info.next_u64(value))
+					return false;
+
+				metric = value;
+				return true;
+			};
+
+			// Extract all metrics from meminfo
+			for (float metric; process_line(metric); ram_metrics.push_back(metric));
+		}
+
+		// SReclaimable is the last field used
+		if (ram_metrics.size() < 24)
+			return status{ -1.0f, -1.0f, -1.0f };
+
+		// Position of MemTotal
+		const float mem_total = ram_metrics[0];
+		// Position of MemFree
+		const float mem_free = ram_metrics[1];
+		// Position of Buffers
+		const float mem_buffer = ram_metrics[3];
+		// Position of Cached:
+		const float mem_cached = ram_metrics[4];
+		// Position of SReclaimable
+		const float mem_sreclaimable = ram_metrics[23];
+
+		// Calculates used memory of system
+		const float mem_used = mem_total - mem_free - mem_buffer - mem_cached - mem_sreclaimable;
+		
+		// Update metrics queue using certain amount of samples
+		if (metrics_queue.size() >= SAMPLES)
+			metrics_queue.erase(metrics_queue.begin());
+
+		metrics_queue.push_back(mem_used);
+
+		const float mem_used_avg = std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size());
+		const float mem_used_percent_avg = (mem_used_avg / mem_total) * 100.0f;
+
+		// Get ram status
+		return status { 
+			mem_used_avg * KB_TO_GB,
+			mem_total * KB_TO_GB,
+			mem_used_percent_avg
+		};
+	}
+}
+
+//
+//	CGROUP Metrics
+//
+namespace cgroup
+{
+	struct status
+	{
+		std::string name;
+		float cpu_percent;	// of quota, or of one core when unlimited
+		float cpu_limit;	// in cores, 0 when unlimited
+		float mem_used;		// in GB
+		float mem_max;		// in GB, 0 when unlimited
+		float io_read;		// in MB/s
+		float io_write;		// in MB/s
+	};
+
+	struct group
+	{
+		std::string name;
+		std::string dir;
+		bool primed = false;
+		int64_t previous_ns = 0;
+		uint64_t previous_usage_usec = 0;
+		uint64_t previous_rbytes = 0;
+		uint64_t previous_wbytes = 0;
+	};
+
+	// Constants
+	const char* MOUNT_DIR = "/sys/fs/cgroup";
+	const char* PROC_SELF_CGROUP = "/proc/self/cgroup";
+	const char* CURRENT_GROUP = "self";
+	const float BYTES_TO_GB = 1.0f / 1073741824.0f;
+	const float BYTES_TO_MB = 1.0f / 1048576.0f;
+
+	// Files read every frame for each group
+	const char* FILES[] = { "/cpu.stat", "/cpu.max", "/memory.current", "/memory.max", "/io.stat" };
+
+	// Monitored groups, empty when showing host wide metrics
+	std::vector<group> groups;
+
+	/**
+	 * @brief finds the cgroup v2 path of this process
+	 * @return std::string relative to the cgroup mount, "/" when in root cgroup
+	 */
+	std::string current_path()
+	{
+		const std::string content = capture::read(PROC_SELF_CGROUP);
+		text::scanner self_cgroup(content);
+
+		// Unified hierarchy entry has the form "0::/path"
+		for (std::string line; self_cgroup.next_line(line);)
+		{
+			if (line.rfind("0::", 0) == 0)
+				return line.substr(3);
+		}
+
+		return "/";
+	}
+
+	/**
+	 * @brief adds a group to monitor, groups without v2 memory accounting are skipped
+	 * @param std::string path relative to the cgroup mount, "self" for the current group
+	 */
+	void add_group(const std::string& path)
+	{
+		std::string relative = path == CURRENT_GROUP ? current_path() : path;
+		if (relative.empty() || relative.front() != '/')
+			relative.insert(0, "/");
+
+		const std::string dir = MOUNT_DIR + (relative.size() > 1 ? relative : std::string());
+
+		// Root group and v1/hybrid layouts have no memory.current, every value would read 0
+		std::string probe;
+		if (!capture::read(dir + "/memory.current", probe))
+		{
+			text::err << "cgroup " << relative << " skipped, " << dir
+				<< " has no memory.current (root group or no cgroup v2 memory controller)\n";
+			text::err.flush();
+			return;
+		}
+
+		// Last path component is short enough for the bar
+		const size_t slash = relative.find_last_of('/');
+		const std::string name = relative.size() > 1 ? relative.substr(slash + 1) : "root";
+
+		groups.push_back({ name, dir });
+	}
+
+	// Reads a single value file, "max" meaning unlimited reads as 0
+	uint64_t read_value(const std::string& path)
+	{
+		const std::string content = capture::read(path);
+
+		uint64_t value = 0;
+		text::scanner(content).next_u64(value);
+		return value;
+	}
+
+	std::vector<status> get_cgroup_metrics()
+	{
+		if (groups.empty())
+			return {};
+
+		int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		capture::values("cgroup:clock", now_ns);
+
+		std::vector<status> metrics;
+		metrics.reserve(groups.size());
+
+		for (group& g : groups)
+		{
+			status metric{ g.name, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+			// Lines have the form "usage_usec 1234"
+			uint64_t usage_usec = 0;
+			{
+				const std::string content = capture::read(g.dir + "/cpu.stat");
+				text::scanner cpu_stat(content);
+
+				for (std::string key; cpu_stat.next_word(key); cpu_stat.skip_line())
+				{
+					if (key == "usage_usec")
+					{
+						cpu_stat.next_u64(usage_usec);
+						break;
+					}
+				}
+			}
+
+			// Content has the form "$QUOTA $PERIOD" with "max" quota when unlimited
+			{
+				const std::string content = capture::read(g.dir + "/cpu.max");
+				text::scanner cpu_max(content);
+
+				uint64_t quota, period;
+				if (cpu_max.next_u64(quota) && cpu_max.next_u64(period) && period)
+					metric.cpu_limit = float(quota) / period;
+			}
+
+			metric.mem_used = read_value(g.dir + "/memory.current") * BYTES_TO_GB;
+			metric.mem_max = read_value(g.dir + "/memory.max") * BYTES_TO_GB;
+
+			// Lines have the form "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=5 dios=6"
+			uint64_t rbytes = 0, wbytes = 0;
+			{
+				const std::string content = capture::read(g.dir + "/io.stat");
+				text::scanner io_stat(content);
+
+				for (std::string field; io_stat.next_word(field);)
+				{
+					if (field.rfind("rbytes=", 0) == 0)
+						rbytes += std::strtoull(field.c_str() + 7, nullptr, 10);
+					else if (field.rfind("wbytes=", 0) == 0)
+						wbytes += std::strtoull(field.c_str() + 7, nullptr, 10);
+				}
+			}
+
+			// First sample only sets the reference point
+			if (g.primed && now_ns > g.previous_ns)
+			{
+				// Counters restart when a group is recreated
+				auto delta = [](uint64_t current, uint64_t previous) { return current >= previous ? current - previous : 0; };
+
+				const float elapsed_usec = (now_ns - g.previous_ns) / 1000.0f;
+				const float elapsed_sec = elapsed_usec / 1e6f;
+				const float cores_used = delta(usage_usec, g.previous_usage_usec) / elapsed_usec;
+
+				metric.cpu_percent = 100.0f * cores_used / (metric.cpu_limit > 0 ? metric.cpu_limit : 1.0f);
+				metric.io_read = delta(rbytes, g.previous_rbytes) * BYTES_TO_MB / elapsed_sec;
+				metric.io_write = delta(wbytes, g.previous_wbytes) * BYTES_TO_MB / elapsed_sec;
+			}
+
+			g.primed = true;
+			g.previous_ns = now_ns;
+			g.previous_usage_usec = usage_usec;
+			g.previous_rbytes = rbytes;
+			g.previous_wbytes = wbytes;
+
+			metrics.push_back(metric);
+		}
+
+		return metrics;
+	}
+}
+
+//
+//	Event loop (epoll wait between frames)
+//
+namespace events
+{
+	// Called with the epoll events of its descriptor, returns how soon the next frame is due
+	typedef std::function<std::chrono::milliseconds(uint32_t)> handler_t;
+
+	const int MAX_EVENTS = 8;
+
+	int epoll_fd = -1;
+
+	// Handlers indexed by epoll data
+	std::vector<handler_t> handlers;
+
+	/**
+	 * @brief registers a descriptor in the event loop
+	 * @param int descriptor to watch
+	 * @param uint32_t epoll events mask
+	 * @param handler_t called when descriptor is ready
+	 * @return bool false when descriptor could not be registered
+	 */
+	bool add(int fd, uint32_t mask, handler_t on_event)
+	{
+		if (epoll_fd < 0)
+			epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+		if (epoll_fd < 0)
+		{
+			LOG_ERROR("Failed to create epoll instance");
+			return false;
+		}
+
+		epoll_event event{};
+		event.events = mask;
+		event.data.u32 = handlers.size();
+
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+			return false;
+
+		handlers.push_back(std::move(on_event));
+		return true;
+	}
+
+	void remove(int fd)
+	{
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+
+	/**
+	 * @brief sleeps for the frame interval, returning earlier when a handler asks for it
+	 * @param std::chrono::milliseconds maximum time to wait
+	 */
+	void wait(std::chrono::milliseconds timeout)
+	{
+		// Replay paces itself
+		if (capture::replaying())
+			return;
+
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		if (epoll_fd < 0)
+		{
+			std::this_thread::sleep_until(deadline);
+			return;
+		}
+
+		for (auto now = std::chrono::steady_clock::now(); now < deadline; now = std::chrono::steady_clock::now())
+		{
+			// Rounded up so sub-millisecond remainders do not spin
+			const int wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+
+			epoll_event ready[MAX_EVENTS];
+			const int count = epoll_wait(epoll_fd, ready, MAX_EVENTS, wait_ms);
+
+			for (int i = 0; i < count; ++i)
+				deadline = std::min(deadline, std::chrono::steady_clock::now() + handlers[ready[i].data.u32](ready[i].events));
+		}
+	}
+}
+
+//
+//	PRESSURE Metrics
+//
+namespace pressure
+{
+	struct status
+	{
+		std::string name;
+		float some;		// avg10 in %
+		float full;		// avg10 in %
+		bool stalling;	// kernel trigger fired recently
+	};
+
+	struct resource
+	{
+		const char* file;
+		const char* label;
+		const char* kind;
+		unsigned int stall_percent;
+	};
+
+	struct source
+	{
+		std::string name;
+		std::string path;
+		const resource* res;
+		int fd = -1;
+		std::chrono::steady_clock::time_point last_event{};
+	};
+
+	// Constants
+	const char* PROC_PRESSURE_DIR = "/proc/pressure/";
+
+	// Stall share of the window that wakes us up, per resource
+	const resource RESOURCES[] = {
+		{ "cpu", "cpu", "some", 50 },
+		{ "memory", "mem", "some", 10 },
+		{ "io", "io", "some", 30 },
+	};
+
+	// Trigger windows in us, unprivileged triggers only accept multiples of 2s
+	const unsigned int TRIGGER_WINDOWS[] = { 1000000, 2000000 };
+
+	// How long a stall stays highlighted after the kernel notified us
+	const std::chrono::seconds ALERT_HOLD{5};
+
+	// Pressure sources storage
+	std::vector<source> sources;
+
+	std::chrono::milliseconds on_trigger(source& src, uint32_t ready)
+	{
+		// Monitored cgroup went away, stop watching it
+		if (ready & EPOLLERR)
+		{
+			LOG_WARN("Pressure trigger lost: %", src.path);
+			events::remove(src.fd);
+			close(src.fd);
+			src.fd = -1;
+		}
+		else if (ready & EPOLLPRI)
+		{
+			LOG_INFO("Pressure threshold crossed: %", src.path);
+			src.last_event = std::chrono::steady_clock::now();
+		}
+
+		// Stalls are shown right away
+		return std::chrono::milliseconds(0);
+	}
+
+	bool arm_trigger(source& src)
+	{
+		src.fd = open(src.path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (src.fd < 0)
+		{
+			LOG_WARN("Failed to open pressure file: %", src.path);
+			return false;
+		}
+
+		for (const unsigned int window : TRIGGER_WINDOWS)
+		{
+			const std::string trigger = std::string(src.res->kind) + " "
+				+ std::to_string(window / 100 * src.res->stall_percent) + " "
+				+ std::to_string(window);
+
+			// Kernel expects the terminating null byte to be written too
+			if (write(src.fd, trigger.c_str(), trigger.size() + 1) < 0)
+				continue;
+
+			const size_t index = &src - sources.data();
+			if (!events::add(src.fd, EPOLLPRI, [index](uint32_t ready) { return on_trigger(sources[index], ready); }))
+				break;
+
+			LOG_INFO("Pressure trigger armed: % (%)", src.path, trigger);
+			return true;
+		}
+
+		LOG_WARN("Failed to arm pressure trigger: %", src.path);
+		close(src.fd);
+		src.fd = -1;
+		return false;
+	}
+
+	void init_pressure()
+	{
+		const std::string cgroup_path = cgroup::current_path();
+
+		for (const resource& res : RESOURCES)
+		{
+			sources.push_back({ res.label, std::string(PROC_PRESSURE_DIR) + res.file, &res });
+
+			// Root cgroup has no pressure files, /proc/pressure already covers it
+			if (cgroup_path != "/")
+				sources.push_back({ std::string("cg:") + res.label, cgroup::MOUNT_DIR + cgroup_path + "/" + res.file + ".pressure", &res });
+		}
+
+		// Drop sources the kernel does not expose (no CONFIG_PSI, psi=0, ...)
+		sources.erase(std::remove_if(sources.begin(), sources.end(), [](const source& src) {
+			std::string probe;
+			return !capture::read(src.path, probe);
+		}), sources.end());
+
+		// Replayed stalls come from the log, no kernel to wake us
+		if (capture::replaying())
+			return;
+
+		for (source& src : sources)
+			arm_trigger(src);
+	}
+
+	std::vector<status> get_pressure_metrics()
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		std::vector<status> metrics;
+		metrics.reserve(sources.size());
+
+		for (const source& src : sources)
+		{
+			status metric{ src.name, 0.0f, 0.0f, false };
+
+			// Lines have the form "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+			const std::string content = capture::read(src.path);
+			text::scanner pressure_file(content);
+
+			for (std::string kind; pressure_file.next_word(kind); pressure_file.skip_line())
+			{
+				float value = 0.0f;
+				if (!pressure_file.skip_past('=') || !pressure_file.next_float(value))
+					break;
+
+				if (kind == "some")
+					metric.some = value;
+				else if (kind == "full")
+					metric.full = value;
+			}
+
+			metric.stalling = src.last_event.time_since_epoch().count() && now - src.last_event < ALERT_HOLD;
+			capture::values("stalling:" + src.path, metric.stalling);
+
+			metrics.push_back(metric);
+		}
+
+		return metrics;
+	}
+}
+
+//
+//	TEMP Metrics
+//
+namespace temp
+{
+	// Temperature chip data
+	const sensors_chip_name* cpu_chip_name = nullptr;
+	int cpu_subfeature_number = -1;
+
+	// Temperature sensors types
+	const std::string sensor_types = "coretemp via_cputemp cpu_thermal k10temp zenpower acpitz";
+
+	/**
+	 * @brief picks a chip by name and checks the subfeature still reads
+	 * @param const std::string& chip name as printed by sensors_snprintf_chip_name
+	 * @param int subfeature number
+	 * @return bool true when the sensor is usable
+	 */
+	bool restore_sensor(const std::string& name, int number)
+	{
+		sensors_chip_name match;
+		if (sensors_parse_chip_name(name.c_str(), &match) != 0)
+			return false;
+
+		int nr = 0;
+		const sensors_chip_name* chip = sensors_get_detected_chips(&match, &nr);
+		sensors_free_chip_name(&match);
+
+		double value;
+		if (!chip || sensors_get_value(chip, number, &value) < 0)
+			return false;
+
+		LOG_INFO("Reusing temperature sensor: % / subfeature: %", name, number);
+		cpu_chip_name = chip;
+		cpu_subfeature_number = number;
+		return true;
+	}
+
+	/**
+	 * @return std::string name of the selected chip, empty when none
+	 */
+	std::string chip_name()
+	{
+		char name[256];
+		if (!cpu_chip_name || sensors_snprintf_chip_name(name, sizeof(name), cpu_chip_name) < 0)
+			return "";
+		return name;
+	}
+
+	/**
+	 * @param const std::string& chip name of a previous run, tried before enumerating
+	 * @param int subfeature number of a previous run
+	 */
+	void init_sensors(const std::string& cached_chip = "", int cached_subfeature = -1)
+	{
+		if (!sensors_init(NULL))
+			LOG_INFO("Successful initialized libsensor");
+		else
+			LOG_ERROR("Failed to initialize libsensor");
+
+		if (!cached_chip.empty() && restore_sensor(cached_chip, cached_subfeature))
+			return;
+
+		int nr = 0;
+		for (const sensors_chip_name* chip = sensors_get_detected_chips(NULL, &nr); chip; chip = sensors_get_detected_chips(0, &nr))
+		{
+			if (sensor_types.find(std::string(chip->prefix)) != std::string::npos)
+			{
+				LOG_INFO("Found temperature sensor, prefix: %, path: %", chip->prefix, chip->path);
+				int ft = 0;
+				for (const sensors_feature* feature = sensors_get_features(chip, &ft); feature; feature = sensors_get_features(chip, &ft))
+				{
+					if (std::string(feature->name).find("temp1") != std::string::npos)
+					{
+						LOG_INFO("Found temperature sensor feature: %", feature->name);
+
+						const sensors_subfeature* sub_feature = sensors_get_subfeature(chip, feature, SENSORS_SUBFEATURE_TEMP_INPUT);
+						if (!sub_feature)
+							break;
+
+						cpu_chip_name = chip;
+						cpu_subfeature_number = sub_feature->number;
+
+						LOG_INFO("Selected sensor subfeature: % / type: %", sub_feature->name, int(sub_feature->type));
+						break;
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	// For moving average of TEMP metrics
+	const size_t SAMPLES = 1;
+	std::vector<float> metrics_queue;
+
+	float get_cpu_temperature_metrics()
+	{
+		double temperature = 0;
+
+		if (!capture::replaying() && cpu_chip_name)
+			sensors_get_value(cpu_chip_name, cpu_subfeature_number, &temperature);
+
+		capture::values("sensors:temp", temperature);
+
+		// Update metrics queue using certain amount of samples
+		if (metrics_queue.size() >= SAMPLES)
+			metrics_queue.erase(metrics_queue.begin());
+
+		metrics_queue.push_back(temperature);
+	
+		return std::accumulate(metrics_queue.begin(), metrics_queue.end(), 0) / float(metrics_queue.size());
+	}
+}
+
+//
+//	BATTERY Metrics
+//
+namespace battery
+{
+	typedef struct
+	{
+		float power_now;
+		float energy_now;  // in Wh
+		float energy_full; // in Wh
+	} energy_t;
+
+	struct status
+	{
+		int capacity;
+		bool charging;
+		std::string remaining_time;
+	};
+
+	// Constants
+	const char *POWER_SUPPLIES_DIR = "/sys/class/power_supply/";
+	const char *BATTERY_PREFIX = "BAT";
+	
+	// Supplies storages, sorted by battery number
+	std::vector<std::pair<int, std::vector<std::string>>> batteries;
+
+	bool has_battery()
+	{
+		return !capture::list(POWER_SUPPLIES_DIR).empty();
+	}
+
+	void add_supply(int index, const std::string& entry_path)
+	{
+		batteries.push_back({ index, { entry_path + "/capacity", entry_path + "/status", entry_path + "/power_now",
+									   entry_path + "/energy_now", entry_path + "/energy_full" } });
+	}
+
+	void check_supplies()
+	{
+		for (const std::string &entry_path : capture::list(POWER_SUPPLIES_DIR))
+		{
+			size_t bat_search = entry_path.find(BATTERY_PREFIX);
+
+			if (bat_search != std::string::npos)
+			{
+				// Get number of battery
+				const int index = std::atoi(entry_path.c_str() + bat_search + std::strlen(BATTERY_PREFIX));
+
+				add_supply(index, entry_path);
+			}
+		}
+
+		std::sort(batteries.begin(), batteries.end());
+	}
+
+	/**
+	 * @brief reuses batteries found by a previous run instead of walking the supplies dir
+	 * @param cached battery index and supply dir pairs, sorted by index
+	 * @return bool false when a cached battery is gone or none was cached, nothing is kept then
+	 */
+	bool restore_supplies(const std::vector<std::pair<int, std::string>>& cached)
+	{
+		// No battery last time may just mean it was not plugged in yet, look again
+		if (cached.empty())
+			return false;
+
+		for (const auto& [ index, entry_path ] : cached)
+		{
+			if (access((entry_path + "/capacity").c_str(), R_OK) != 0)
+			{
+				batteries.clear();
+				return false;
+			}
+
+			add_supply(index, entry_path);
+		}
+
+		return true;
+	}
+
+	typedef struct
+	{
+		unsigned int last_value_index;
+		const size_t samples;
+		std::vector<float> values = std::vector<float>(samples);
+		float avg = 0;
+	} circular_buffer_t;
+
+	void clear_circular_buffer(circular_buffer_t *buff, float value)
+	{
+		for (int i = 0; i < buff->samples; ++i)
+		{
+			buff->values[i] = value;
+			buff->avg = value * buff->samples;
+		}
+	}
+
+	float moving_average(circular_buffer_t *buff, float value)
+	{
+		if (++buff->last_value_index >= buff->samples)
+			buff->last_value_index = 0;
+
+		buff->avg -= buff->values[buff->last_value_index];
+		buff->values[buff->last_value_index] = value;
+		buff->avg += value;
+		return buff->avg / buff->samples;
+		}
+
+	std::string get_battery_time(energy_t *energy, bool charging)
+	{
+
+		static circular_buffer_t remaining_time = {
+			.last_value_index = 0,
+			.samples = 50};
+
+		static bool was_charging = charging;
+
+		if (energy->power_now == 0)
+			return ("0:00");
+
+		if (was_charging != charging)
+		{
+			was_charging = charging;
+			clear_circular_buffer(&remaining_time, (charging ? energy->energy_full : energy->energy_now) / energy->power_now);
+		}
+
+		float remaining_time_f = moving_average(&remaining_time,
+												(charging ? energy->energy_full : energy->energy_now) / energy->power_now);
+
+		int hours = remaining_time_f;
+		int mins = (remaining_time_f - hours) * 60;
+
+		return std::to_string(hours) + ":" + (mins < 10 ? "0" : "") + std::to_string(mins);
+	}
+
+	status get_battery_metrics()
+	{
+		const float energy_coeff = 1 / 1e6;
+		const float power_coeff = 1 / 1e6;
+		const std::vector<std::string>& paths = batteries.at(0).second;
+
+		// Missing or malformed values read as zero
+		auto read_value = [](const std::string& path) -> float {
+			const std::string content = capture::read(path);
+			float value = 0.0f;
+			text::scanner(content).next_float(value);
+			return value;
+		};
+
+		int battery_value = read_value(paths[0]);
+
+		const std::string status_content = capture::read(paths[1]);
+		std::string battery_status;
+		text::scanner(status_content).next_word(battery_status);
+		bool charging = (battery_status != "Discharging");
+
+		energy_t energy;
+
+		energy.power_now = read_value(paths[2]);
+		energy.power_now *= power_coeff;
+
+		energy.energy_now = read_value(paths[3]);
+		energy.energy_now *= energy_coeff;
+
+		energy.energy_full = read_value(paths[4]);
+		energy.energy_full *= energy_coeff;
+
+		std::string remaining_time = get_battery_time(&energy, charging);
+
+		return status{
+			battery_value,
+			charging,
+			remaining_time,
+		};
+	}
+}
+
+//
+//	POWER Metrics
+//
+
+//
+//	VOL Metrics
+//
+namespace audio
+{
+	// Volume configs
+	const char* volume_card = "default";
+	const char* volume_mixer_name = "Master";
+	const int volume_mixer_index = 0;
+
+	snd_mixer_t* volume_handle;
+	snd_mixer_elem_t* volume_element;
+	snd_mixer_selem_id_t* volume_sid;
+
+	// Range cached at init, writes skip the query
+	long volume_min = 0, volume_max = 100;
+
+	// Mic configs
+	const char* mic_card = "default";
+	const char* mic_mixer_name = "Capture";
+	const int mic_mixer_index = 0;
+
+	snd_mixer_t* mic_handle;
+	snd_mixer_elem_t* mic_element;
+	snd_mixer_selem_id_t* mic_sid;
+
+	// Range cached at init, writes skip the query
+	long mic_min = 0, mic_max = 100;
+
+	struct status
+	{
+		long volume;
+		bool is_active;
+	};
+
+	void init_connection(
+		const char* card, const char* mixer_name, const int mixer_index,
+		snd_mixer_t** handle, snd_mixer_elem_t** element, snd_mixer_selem_id_t** sid
+	)
+	{
+		snd_mixer_selem_id_alloca(&(*sid));
+
+		snd_mixer_selem_id_set_name(*sid, mixer_name);
+		snd_mixer_selem_id_set_index(*sid, mixer_index);
+
+		if (snd_mixer_open(&(*handle), 0) < 0)
+			LOG_ERROR("Failed to open sound mixer");
+		else
+			LOG_INFO("Sound mixer successfully opened");
+			
+
+		if (snd_mixer_attach(*handle, card) < 0)
+			LOG_ERROR("Failed to attach sound mixer");
+		else
+			LOG_INFO("Sound mixer successfully attached");
+
+		if (snd_mixer_selem_register(*handle, NULL, NULL) < 0)
+			LOG_ERROR("Failed to register sound element");
+		else
+			LOG_INFO("Sound element successfully registered");
+
+		const int mixer = snd_mixer_load(*handle);
+		if (mixer < 0)
+			LOG_ERROR("Failed to load mixer");
+		else
+			LOG_INFO("Mixer successfully loaded");
+
+		*element = snd_mixer_find_selem(*handle, *sid);
+		if (!*element)
+			LOG_ERROR("Failed to find sound element");
+		else
+			LOG_INFO("Sound element successfully found");
+	}
+
+	void init_mic_connections()
+	{
+		init_connection(mic_card, mic_mixer_name, mic_mixer_index, &mic_handle, &mic_element, &mic_sid);
+
+		if (mic_element)
+			snd_mixer_selem_get_capture_volume_range(mic_element, &mic_min, &mic_max);
+	}
+
+	void init_volume_connections()
+	{
+		init_connection(volume_card, volume_mixer_name, volume_mixer_index, &volume_handle, &volume_element, &volume_sid);
+
+		if (volume_element)
+			snd_mixer_selem_get_playback_volume_range(volume_element, &volume_min, &volume_max);
+	}
+
+	void close_mic_connection()
+	{
+		snd_mixer_close(volume_handle);
+	}
+
+	void close_volume_connection()
+	{
+		snd_mixer_close(mic_handle);
+	}
+
+	status get_mic()
+	{
+		int is_active_left = 0, is_active_right = 0;
+		long min_volume = 0, max_volume = 0;
+		long out_volume_left = 0, out_volume_right = 0;
+
+		if (!capture::replaying())
+		{
+			snd_mixer_handle_events(mic_handle);
+
+			snd_mixer_selem_get_capture_volume_range(mic_element, &min_volume, &max_volume);
+
+			if (snd_mixer_selem_get_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_LEFT, &out_volume_left) < 0)
+			{
+				snd_mixer_close(mic_handle);
+				LOG_ERROR("Failed to get volume of mic element in left chanel");
+			}
+
+			if (snd_mixer_selem_get_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_RIGHT, &out_volume_right) < 0)
+			{
+				snd_mixer_close(mic_handle);
+				LOG_ERROR("Failed to get volume of mic element in rigth chanel");
+			}
+
+			if (snd_mixer_selem_get_capture_switch(mic_element, SND_MIXER_SCHN_FRONT_LEFT, &is_active_left) < 0)
+			{
+				snd_mixer_close(mic_handle);
+				LOG_ERROR("Failed to get switch status of mic element in left chanel");
+			}
+
+			if (snd_mixer_selem_get_capture_switch(mic_element, SND_MIXER_SCHN_FRONT_RIGHT, &is_active_right) < 0)
+			{
+				snd_mixer_close(mic_handle);
+				LOG_ERROR("Failed to get switch status of mic element in rigth chanel");
+			}
+		}
+
+		capture::values("mixer:mic", min_volume, max_volume, out_volume_left, out_volume_right, is_active_left, is_active_right);
+
+		// Calculate real maximum volume
+		max_volume -= min_volume;
+
+		// Adjust to minimum bound
+		out_volume_left -= min_volume;
+		out_volume_right -= min_volume;
+
+		// Adjust to 100% scale, rounded like the setters so written values read back the same
+		out_volume_left = (100 * out_volume_left + max_volume / 2) / max_volume;
+		out_volume_right = (100 * out_volume_right + max_volume / 2) / max_volume;
+
+		// Return max of two chanel
+		return {std::max(out_volume_left, out_volume_right), (bool(is_active_left) || bool(is_active_right))};
+	}
+
+	void set_mic(long in_volume)
+	{
+		// Nothing to drive while replaying
+		if (capture::replaying() || !mic_element)
+			return;
+
+		// Checks for volume bounds
+		if (in_volume < 0 || in_volume > 100)
+			LOG_ERROR("Trying to set volume out of bounds");
+
+		in_volume = std::clamp(in_volume, 0L, 100L);
+
+		// Adjust volume to perform set operation
+		in_volume = (in_volume * (mic_max - mic_min) + 50) / 100 + mic_min;
+
+		// Set in every channel at once
+		if (snd_mixer_selem_set_capture_volume_all(mic_element, in_volume) < 0)
+		{
+			snd_mixer_close(mic_handle);
+			LOG_ERROR("Failed to set volume of mic element");
+		}
+	}
+
+	void set_mic_switch(bool is_active)
+	{
+		// Nothing to drive while replaying
+		if (capture::replaying() || !mic_element)
+			return;
+
+		if (snd_mixer_selem_set_capture_switch_all(mic_element, is_active) < 0)
+		{
+			snd_mixer_close(mic_handle);
+			LOG_ERROR("Failed to set switch state of mic element");
+		}
+	}
+
+	status get_vol()
+	{
+		int is_active_left = 0, is_active_right = 0;
+		long min_volume = 0, max_volume = 0;
+		long out_volume_left = 0, out_volume_right = 0;
+
+		if (!capture::replaying())
+		{
+			snd_mixer_handle_events(volume_handle);
+
+			snd_mixer_selem_get_playback_volume_range(volume_element, &min_volume, &max_volume);
+
+			if (snd_mixer_selem_get_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_LEFT, &out_volume_left) < 0)
+			{
+				snd_mixer_close(volume_handle);
+				LOG_ERROR("Failed to get volume of sound element in left chanel");
+			}
+
+			if (snd_mixer_selem_get_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_RIGHT, &out_volume_right) < 0)
+			{
+				snd_mixer_close(volume_handle);
+				LOG_ERROR("Failed to get volume of sound element in rigth chanel");
+			}
+
+			if (snd_mixer_selem_get_playback_switch(volume_element, SND_MIXER_SCHN_FRONT_RIGHT, &is_active_right) < 0)
+			{
+				snd_mixer_close(volume_handle);
+				LOG_ERROR("Failed to get switch state of sound element in rigth chanel");
+			}
+
+			if (snd_mixer_selem_get_playback_switch(volume_element, SND_MIXER_SCHN_FRONT_LEFT, &is_active_left) < 0)
+			{
+				snd_mixer_close(volume_handle);
+				LOG_ERROR("Failed to get switch state of sound element in rigth chanel");
+			}
+		}
+
+		capture::values("mixer:vol", min_volume, max_volume, out_volume_left, out_volume_right, is_active_left, is_active_right);
+
+		// Calculate real maximum volume
+		max_volume -= min_volume;
+
+		// Adjust to minimum bound
+		out_volume_left -= min_volume;
+		out_volume_right -= min_volume;
+
+		// Adjust to 100% scale, rounded like the setters so written values read back the same
+		out_volume_left = (100 * out_volume_left + max_volume / 2) / max_volume;
+		out_volume_right = (100 * out_volume_right + max_volume / 2) / max_volume;
+
+		// Return max of two chanel
+		return status{std::max(out_volume_left, out_volume_right), (bool(is_active_left) || bool(is_active_right))};
+	}
+
+	void set_vol(long in_volume)
+	{
+		// Nothing to drive while replaying
+		if (capture::replaying() || !volume_element)
+			return;
+
+		// Checks for volume bounds
+		if (in_volume < 0 || in_volume > 100)
+			LOG_ERROR("Trying to set volume out of bounds");
+
+		in_volume = std::clamp(in_volume, 0L, 100L);
+
+		// Adjust volume to perform set operation
+		in_volume = (in_volume * (volume_max - volume_min) + 50) / 100 + volume_min;
+
+		// Set in every channel at once
+		if (snd_mixer_selem_set_playback_volume_all(volume_element, in_volume) < 0)
+		{
+			snd_mixer_close(volume_handle);
+			LOG_ERROR("Failed to set volume of sound element");
+		}
+	}
+
+	void set_vol_switch(bool is_active)
+	{
+		// Nothing to drive while replaying
+		if (capture::replaying() || !volume_element)
+			return;
+
+		if (snd_mixer_selem_set_playback_switch_all(volume_element, is_active) < 0)
+		{
+			snd_mixer_close(volume_handle);
+			LOG_ERROR("Failed to set switch state of sound element");
+		}
+	}
+}
+
+//
+//	Volume / mic control channel
+//
+namespace control
+{
+	enum channel_id { VOLUME = 0, MIC = 1 };
+
+	struct channel
+	{
+		// Requested since last frame, collapsed into one write
+		long pending_volume = -1;
+		int pending_active = -1;
+
+		// Written this frame, shown before the mixer reports it back
+		long written_volume = -1;
+		int written_active = -1;
+
+		// Mixers with fewer than 100 steps cannot hold every percent, the written one
+		// is kept while the mixer still reports what it read back as after the write
+		long held_volume = -1;
+		long held_reading = -1;
+
+		audio::status last{ 0, false };
+	};
+
+	// Constants
+	const char* FIFO_NAME = "/task-bar.ctl";
+
+	// Longest command line kept, longer ones are dropped up to their newline
+	const size_t MAX_COMMAND_LENGTH = 512;
+
+	// How long a command may wait for more to coalesce before the frame is drawn
+	const std::chrono::milliseconds COALESCE_WINDOW{16};
+
+	channel channels[2];
+
+	int fifo_fd = -1;
+	std::string fifo_path;
+	std::string partial_line;
+	bool dropping_line = false;
+
+	// Per instance FIFO made because the shared one was taken, removed on exit
+	bool owns_instance_fifo = false;
+
+	// A non-blocking writer only opens a FIFO that some reader holds open
+	bool fifo_has_reader(const std::string& path)
+	{
+		const int fd = open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		close(fd);
+		return true;
+	}
+
+	/**
+	 * @brief parses a command of form "<vol|mic> <N|+N|-N|mute|unmute|toggle>"
+	 */
+	void parse_command(const std::string& line)
+	{
+		std::string target, argument;
+		text::scanner command(line);
+
+		if (!command.next_word(target) || !command.next_word(argument))
+			return;
+
+		channel* ch = target == "vol" ? &channels[VOLUME] : target == "mic" ? &channels[MIC] : nullptr;
+		if (!ch)
+		{
+			LOG_WARN("Unknown control target: %", target);
+			return;
+		}
+
+		// Relative changes stack on top of what is already requested
+		const long base = ch->pending_volume >= 0 ? ch->pending_volume : ch->last.volume;
+		const bool active = ch->pending_active >= 0 ? ch->pending_active : ch->last.is_active;
+
+		if (argument == "mute")
+			ch->pending_active = 0;
+		else if (argument == "unmute")
+			ch->pending_active = 1;
+		else if (argument == "toggle")
+			ch->pending_active = !active;
+		else if (argument[0] == '+' || argument[0] == '-')
+			ch->pending_volume = std::clamp(base + std::strtol(argument.c_str(), nullptr, 10), 0L, 100L);
+		else if (isdigit(static_cast<unsigned char>(argument[0])))
+			ch->pending_volume = std::clamp(std::strtol(argument.c_str(), nullptr, 10), 0L, 100L);
+		else
+			LOG_WARN("Unknown control argument: %", argument);
+	}
+
+	std::chrono::milliseconds on_command(uint32_t)
+	{
+		char buffer[512];
+		for (ssize_t size; (size = ::read(fifo_fd, buffer, sizeof(buffer))) > 0;)
+		{
+			partial_line.append(buffer, size);
+
+			// Only complete lines are commands
+			size_t start = 0;
+			for (size_t end; (end = partial_line.find('\n', start)) != std::string::npos; start = end + 1)
+			{
+				if (!dropping_line && end - start <= MAX_COMMAND_LENGTH)
+					parse_command(partial_line.substr(start, end - start));
+				dropping_line = false;
+			}
+
+			partial_line.erase(0, start);
+
+			// A writer that never ends its line cannot grow the buffer past one command
+			if (partial_line.size() > MAX_COMMAND_LENGTH)
+			{
+				LOG_WARN("Control command over % bytes dropped", MAX_COMMAND_LENGTH);
+				partial_line.clear();
+				dropping_line = true;
+			}
+		}
+
+		return COALESCE_WINDOW;
+	}
+
+	/**
+	 * @brief creates the control FIFO and registers it in the event loop
+	 * @param const char* FIFO path, defaults to $XDG_RUNTIME_DIR/task-bar.ctl
+	 */
+	void init_control(const char* path)
 	{
-		snd_mixer_selem_id_alloca(&(*sid));
+		if (path)
+			fifo_path = path;
+		else
+		{
+			// Only the private runtime dir is trusted, anyone could plant the FIFO in a shared /tmp
+			const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+			if (!runtime_dir)
+			{
+				text::err << "Control FIFO disabled: XDG_RUNTIME_DIR unset, pass --control <fifo>\n";
+				text::err.flush();
+				return;
+			}
+			fifo_path = std::string(runtime_dir) + FIFO_NAME;
 
-		snd_mixer_selem_id_set_name(*sid, mixer_name);
-		snd_mixer_selem_id_set_index(*sid, mixer_index);
+			// A command on a shared FIFO reaches only the bar that reads it first
+			if (fifo_has_reader(fifo_path))
+			{
+				const std::string taken = fifo_path;
+				fifo_path = std::string(runtime_dir) + "/task-bar." + std::to_string(getpid()) + ".ctl";
+				owns_instance_fifo = true;
+				text::err << "Control FIFO " << taken << " is used by another bar, listening on " << fifo_path
+					<< " (give each bar its own --control)\n";
+				text::err.flush();
+			}
+		}
 
-		if (snd_mixer_open(&(*handle), 0) < 0)
-			LOG_ERROR("Failed to open sound mixer");
+		if (mkfifo(fifo_path.c_str(), 0600) < 0 && errno != EEXIST)
+		{
+			text::err << "Failed to create control FIFO: " << fifo_path << '\n';
+			text::err.flush();
+			return;
+		}
+
+		// Read-write keeps a writer open, so closing clients never leaves the FIFO hung up
+		fifo_fd = open(fifo_path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC | O_NOFOLLOW);
+		if (fifo_fd < 0)
+		{
+			text::err << "Failed to open control FIFO: " << fifo_path << '\n';
+			text::err.flush();
+			return;
+		}
+
+		// Commands drive the mixer, only a FIFO nobody else can write to is accepted
+		struct stat fifo_info;
+		const bool is_private = fstat(fifo_fd, &fifo_info) == 0 && S_ISFIFO(fifo_info.st_mode)
+			&& fifo_info.st_uid == getuid() && !(fifo_info.st_mode & (S_IWGRP | S_IWOTH));
+
+		if (!is_private || !events::add(fifo_fd, EPOLLIN, on_command))
+		{
+			text::err << "Control FIFO rejected, not a FIFO owned and only writable by this user: " << fifo_path << '\n';
+			text::err.flush();
+			close(fifo_fd);
+			fifo_fd = -1;
+			return;
+		}
+
+		LOG_INFO("Control FIFO ready: %", fifo_path);
+	}
+
+	void close_control()
+	{
+		if (fifo_fd >= 0)
+			close(fifo_fd);
+
+		if (owns_instance_fifo)
+			unlink(fifo_path.c_str());
+	}
+
+	/**
+	 * @brief writes everything requested since last frame, once per channel
+	 */
+	void apply()
+	{
+		for (channel& ch : channels)
+		{
+			ch.written_volume = ch.pending_volume;
+			ch.written_active = ch.pending_active;
+
+			ch.pending_volume = -1;
+			ch.pending_active = -1;
+		}
+
+		// Commands the recording received are shown the same when replayed
+		capture::values("control", channels[VOLUME].written_volume, channels[VOLUME].written_active,
+			channels[MIC].written_volume, channels[MIC].written_active);
+
+		if (channels[VOLUME].written_volume >= 0)
+			audio::set_vol(channels[VOLUME].written_volume);
+		if (channels[VOLUME].written_active >= 0)
+			audio::set_vol_switch(channels[VOLUME].written_active);
+
+		if (channels[MIC].written_volume >= 0)
+			audio::set_mic(channels[MIC].written_volume);
+		if (channels[MIC].written_active >= 0)
+			audio::set_mic_switch(channels[MIC].written_active);
+	}
+
+	/**
+	 * @brief shows values written this frame instead of their mixer readback
+	 * @param channel_id channel to show
+	 * @param audio::status values read from mixer
+	 * @return audio::status values to draw
+	 */
+	audio::status shown(channel_id id, audio::status mixer)
+	{
+		channel& ch = channels[id];
+
+		if (ch.written_volume >= 0)
+		{
+			ch.held_volume = ch.written_volume;
+			ch.held_reading = mixer.volume;
+		}
+
+		// Any other change of the mixer drops the held value
+		if (ch.held_volume >= 0 && mixer.volume == ch.held_reading)
+			mixer.volume = ch.held_volume;
 		else
-			LOG_INFO("Sound mixer successfully opened");
+			ch.held_volume = -1;
+
+		if (ch.written_active >= 0)
+			mixer.is_active = ch.written_active;
+
+		ch.last = mixer;
+		return mixer;
+	}
+}
+
+//
+//	DATE Metrics
+//
+namespace date
+{
+	std::string get_formated_date()
+	{
+		auto time_shot = time(0);
+		capture::values("time", time_shot);
+
+		tm* local_time_shot = localtime(&time_shot);
+
+		char time_str[32];
+
+		const size_t size = strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", local_time_shot);
+
+		return std::string(time_str, size);
+	}
+}
+
+//
+//	NET Metrics
+//
+
+//
+//	AUR Metrics
+//
+namespace AUR
+{
+	const std::string PACMAN_LOG_PATH = "/var/log/pacman.log";
+	#include <sys/stat.h>
+
+
+	/**
+	 * @brief converts pacman time string to time_t
+	 * @param std::string string with format [yyyy-mm-ddxhh:mm:ss-xxxx] ....
+	 * @return std::time_t 
+	 */
+	std::time_t str2time_t(std::string string)
+	{
+		struct tm  tm;
+		time_t rawtime;
+		time(&rawtime);
+		tm = *localtime(&rawtime);
+		tm.tm_year = stoi(string.substr(1, 4)) - 1900;
+		tm.tm_mon = stoi(string.substr(6, 2)) - 1;
+		tm.tm_mday = stoi(string.substr(9, 2));
+		tm.tm_hour = stoi(string.substr(12, 2));
+		tm.tm_min = stoi(string.substr(15, 2));
+		tm.tm_sec =  stoi(string.substr(18, 2));
+		return mktime(&tm);
+	}
+
+	/**
+	 * @brief converts time in seconds to string
+	 * @param double time in seconds
+	 * @return std::string with format mm-dd hh:mm
+	 */
+	std::string sec2str(double time)
+	{
+		unsigned int months = time/(30 * 24 * 60 * 60);
+		time = time - months * (30 * 24 * 60 * 60);
+		unsigned int days = time / (24 * 60 * 60);
+		time = time - days * (24 * 60 * 60);
+		unsigned int hours = time / (60 * 60);
+		time = time - hours * (60 * 60);
+		unsigned int mins = time / 60;
+		return "m:" + std::to_string(months) + " d:" + std::to_string(days) + " h:" + std::to_string(hours);
+	}
+
+	std::time_t get_last_log_write()
+	{
+		struct stat fileInfo{};
+		int failed = capture::replaying() ? 0 : stat(PACMAN_LOG_PATH.c_str(), &fileInfo);
+		capture::values("stat:" + PACMAN_LOG_PATH, failed, fileInfo.st_mtime);
+		if(failed)
+		{
+			text::err << "Error getting log metadata\n";
+			text::err.flush();
+			return 0;
+		}
+      	return fileInfo.st_mtime;      // Last mod time
+	}
+
+	std::string get_last_update_date()
+	{
+
+		static std::time_t last_log_write = 0;
+		static std::string last_pacman_update = "[1970-01-01T00:00:00-0300]";
+		
+		const std::string SYSTEM_UPGRADE_STR("[yyyy-mm-ddxhh:mm:ss-xxxx] [PACMAN] starting full system upgrade");
+
+		if (get_last_log_write() > last_log_write)
+		{
+			const std::string content = capture::read(PACMAN_LOG_PATH);
+			text::scanner pacman_log(content);
+			text::out << "update!\n";
+			last_log_write = get_last_log_write();
 			
+			for (std::string line; pacman_log.next_line(line);)
+			{
+				if (line.size() == SYSTEM_UPGRADE_STR.size())
+				{
+					text::out << line << "\n";
+					if (line.substr(39) == SYSTEM_UPGRADE_STR.substr(39))
+						last_pacman_update = line;
+				}
+			}
+		}
 
-		if (snd_mixer_attach(*handle, card) < 0)
-			LOG_ERROR("Failed to attach sound mixer");
-		else
-			LOG_INFO("Sound mixer successfully attached");
+		//convert to string and get diference between time now and last update
+		std::time_t time_now = time(0);
+		capture::values("time", time_now);
+		double diff_time = difftime(time_now, str2time_t(last_pacman_update));
+		
+		return sec2str(diff_time);
+	}
+}
+
+//
+//	UPDATES Metrics
+//
+namespace updates
+{
+	// Compact name-to-version index of one sync database, sorted by name
+	struct db_index
+	{
+		std::string path;
+		std::time_t mtime;
+		std::vector<std::pair<std::string, std::string>> packages;
+	};
+
+	// Constants
+	const char* PACMAN_SYNC_DIR = "/var/lib/pacman/sync/";
+	const char* PACMAN_LOCAL_DIR = "/var/lib/pacman/local/";
+	const char* DB_SUFFIX = ".db";
+	const char* PACMAN_CONF = "/etc/pacman.conf";
+	const size_t TAR_BLOCK = 512;
+	const size_t CHUNK_SIZE = 64 * 1024;
+
+	// How often the worker checks databases mtimes
+	const std::chrono::seconds REFRESH_INTERVAL{2};
+
+	// Outdated packages count, -1 until first index is built
+	std::atomic<int> pending{-1};
+
+	/**
+	 * @brief compares two version segments, port of libalpm rpmvercmp
+	 * @return int -1, 0 or 1 like strcmp
+	 */
+	int rpmvercmp(const std::string& a, const std::string& b)
+	{
+		if (a == b)
+			return 0;
+
+		// Bytes go to isalnum and friends, which only take unsigned char values
+		auto at = [](const std::string& s, size_t i) -> int { return i < s.size() ? static_cast<unsigned char>(s[i]) : 0; };
+
+		size_t one = 0, two = 0;
+
+		while (one < a.size() && two < b.size())
+		{
+			const size_t sep_one = one, sep_two = two;
+
+			// Skip separators
+			while (one < a.size() && !isalnum(at(a, one))) ++one;
+			while (two < b.size() && !isalnum(at(b, two))) ++two;
+
+			if (one >= a.size() || two >= b.size())
+				break;
+
+			// More separators means a newer version
+			if (one - sep_one != two - sep_two)
+				return one - sep_one < two - sep_two ? -1 : 1;
+
+			size_t end_one = one, end_two = two;
+			const bool is_num = isdigit(at(a, one));
+
+			if (is_num)
+			{
+				while (isdigit(at(a, end_one))) ++end_one;
+				while (isdigit(at(b, end_two))) ++end_two;
+			}
+			else
+			{
+				while (isalpha(at(a, end_one))) ++end_one;
+				while (isalpha(at(b, end_two))) ++end_two;
+			}
+
+			// Segments of different types, numeric one is newer
+			if (end_two == two)
+				return is_num ? 1 : -1;
+
+			if (is_num)
+			{
+				while (one < end_one - 1 && a[one] == '0') ++one;
+				while (two < end_two - 1 && b[two] == '0') ++two;
+
+				// Longer number wins
+				if (end_one - one != end_two - two)
+					return end_one - one < end_two - two ? -1 : 1;
+			}
+
+			const int rc = a.compare(one, end_one - one, b, two, end_two - two);
+			if (rc)
+				return rc < 0 ? -1 : 1;
+
+			one = end_one;
+			two = end_two;
+		}
+
+		if (one >= a.size() && two >= b.size())
+			return 0;
+
+		// A remaining alpha segment never beats an empty one
+		if ((one >= a.size() && !isalpha(at(b, two))) || isalpha(at(a, one)))
+			return -1;
+
+		return 1;
+	}
+
+	/**
+	 * @brief compares full pacman versions of form [epoch:]version[-release]
+	 * @return int -1, 0 or 1 like strcmp
+	 */
+	int vercmp(const std::string& a, const std::string& b)
+	{
+		auto split = [](const std::string& evr, std::string& epoch, std::string& version, std::string& release) {
+			const size_t colon = evr.find(':');
+			const size_t start = colon == std::string::npos ? 0 : colon + 1;
+			const size_t dash = evr.rfind('-');
+
+			epoch = colon == std::string::npos ? "0" : evr.substr(0, colon);
+			version = evr.substr(start, dash == std::string::npos || dash < start ? std::string::npos : dash - start);
+			release = dash == std::string::npos || dash < start ? "" : evr.substr(dash + 1);
+		};
+
+		std::string epoch_a, version_a, release_a;
+		std::string epoch_b, version_b, release_b;
+		split(a, epoch_a, version_a, release_a);
+		split(b, epoch_b, version_b, release_b);
+
+		int rc = rpmvercmp(epoch_a, epoch_b);
+		if (!rc)
+			rc = rpmvercmp(version_a, version_b);
+		if (!rc && !release_a.empty() && !release_b.empty())
+			rc = rpmvercmp(release_a, release_b);
+
+		return rc;
+	}
+
+	/**
+	 * @brief extracts %NAME% and %VERSION% from a desc entry
+	 */
+	void parse_desc(const char* data, size_t size, std::vector<std::pair<std::string, std::string>>& packages)
+	{
+		std::string name, version;
+
+		const std::string content(data, size);
+		text::scanner desc(content);
+
+		for (std::string line; desc.next_line(line);)
+		{
+			if (line == "%NAME%")
+				desc.next_line(name);
+			else if (line == "%VERSION%")
+				desc.next_line(version);
+		}
+
+		if (!name.empty() && !version.empty())
+			packages.emplace_back(std::move(name), std::move(version));
+	}
+
+	/**
+	 * @brief streams a gzip compressed sync database tarball into an index
+	 * @param std::string path of database
+	 * @param db_index& index to fill
+	 * @return bool false when database could not be decompressed
+	 */
+	bool build_index(const std::string& path, db_index& index)
+	{
+		const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		z_stream stream{};
+
+		// 16 + MAX_WBITS selects gzip framing
+		if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+		{
+			close(fd);
+			return false;
+		}
+
+		index.packages.clear();
+
+		std::vector<unsigned char> in(CHUNK_SIZE);
+		std::string tar;
+		size_t consumed = 0;
+		int rc = Z_OK;
+
+		while (rc != Z_STREAM_END)
+		{
+			const ssize_t size = ::read(fd, in.data(), in.size());
+			if (size <= 0)
+				break;
+
+			stream.next_in = in.data();
+			stream.avail_in = size;
+
+			do
+			{
+				const size_t used = tar.size();
+				tar.resize(used + CHUNK_SIZE);
+
+				stream.next_out = reinterpret_cast<unsigned char*>(&tar[used]);
+				stream.avail_out = CHUNK_SIZE;
+
+				rc = inflate(&stream, Z_NO_FLUSH);
+				tar.resize(used + CHUNK_SIZE - stream.avail_out);
+
+				if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+				{
+					LOG_WARN("Failed to decompress sync database: %", path);
+					inflateEnd(&stream);
+					close(fd);
+					return false;
+				}
+			} while (stream.avail_out == 0 && rc != Z_STREAM_END);
+
+			// Walk every complete tar entry available so far
+			while (tar.size() - consumed >= TAR_BLOCK)
+			{
+				const char* header = tar.data() + consumed;
+
+				// Two zero blocks close the archive
+				if (!header[0])
+				{
+					rc = Z_STREAM_END;
+					break;
+				}
+
+				const size_t entry_size = std::strtoul(std::string(header + 124, 12).c_str(), nullptr, 8);
+				const size_t padded_size = (entry_size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+
+				if (tar.size() - consumed < TAR_BLOCK + padded_size)
+					break;
+
+				const std::string name(header, strnlen(header, 100));
+				const char type = header[156];
+
+				if ((type == '0' || type == '\0') && name.size() >= 4 && name.compare(name.size() - 4, 4, "desc") == 0)
+					parse_desc(header + TAR_BLOCK, entry_size, index.packages);
 
-		if (snd_mixer_selem_register(*handle, NULL, NULL) < 0)
-			LOG_ERROR("Failed to register sound element");
-		else
-			LOG_INFO("Sound element successfully registered");
+				consumed += TAR_BLOCK + padded_size;
+			}
 
-		const int mixer = snd_mixer_load(*handle);
-		if (mixer < 0)
-			LOG_ERROR("Failed to load mixer");
-		else
-			LOG_INFO("Mixer successfully loaded");
+			// Drop processed entries to keep the buffer small
+			tar.erase(0, consumed);
+			consumed = 0;
+		}
 
-		*element = snd_mixer_find_selem(*handle, *sid);
-		if (!*element)
-			LOG_ERROR("Failed to find sound element");
-		else
-			LOG_INFO("Sound element successfully found");
-	}
+		inflateEnd(&stream);
+		close(fd);
 
-	void init_mic_connections()
-	{
-		init_connection(mic_card, mic_mixer_name, mic_mixer_index, &mic_handle, &mic_element, &mic_sid);
-	}
+		std::sort(index.packages.begin(), index.packages.end());
+		index.packages.shrink_to_fit();
 
-	void init_volume_connections()
-	{
-		init_connection(volume_card, volume_mixer_name, volume_mixer_index, &volume_handle, &volume_element, &volume_sid);
+		LOG_INFO("Indexed % packages from %", index.packages.size(), path);
+		return true;
 	}
 
-	void close_mic_connection()
+	/**
+	 * @brief counts installed packages older than the first sync database providing them
+	 */
+	int count_outdated(const std::vector<db_index>& dbs, const std::vector<std::pair<std::string, std::string>>& installed)
 	{
-		snd_mixer_close(volume_handle);
+		int outdated = 0;
+
+		for (const auto& [ name, version ] : installed)
+		{
+			for (const db_index& index : dbs)
+			{
+				auto found = std::lower_bound(index.packages.begin(), index.packages.end(), std::make_pair(name, std::string()));
+				if (found == index.packages.end() || found->first != name)
+					continue;
+
+				if (vercmp(found->second, version) > 0)
+					++outdated;
+				break;
+			}
+		}
+
+		return outdated;
 	}
 
-	void close_volume_connection()
+	/**
+	 * @brief lists installed packages from local database directory names (name-version-release)
+	 */
+	std::vector<std::pair<std::string, std::string>> scan_local()
 	{
-		snd_mixer_close(mic_handle);
+		std::vector<std::pair<std::string, std::string>> installed;
+
+		fs::for_each_entry(PACMAN_LOCAL_DIR, [&installed](const char* entry, unsigned char type) {
+			if (type != DT_DIR && type != DT_UNKNOWN)
+				return;
+
+			const std::string dir(entry);
+			const size_t release = dir.rfind('-');
+			const size_t version = release == std::string::npos ? std::string::npos : dir.rfind('-', release - 1);
+
+			if (version != std::string::npos && version > 0)
+				installed.emplace_back(dir.substr(0, version), dir.substr(version + 1));
+		});
+
+		return installed;
 	}
 
-	status get_mic()
+	/**
+	 * @brief lists repo sections of pacman.conf, pacman looks packages up in this order
+	 */
+	std::vector<std::string> read_repo_order()
 	{
-		snd_mixer_handle_events(mic_handle);
+		std::vector<std::string> repos;
 
-		int is_active_left = 0, is_active_right = 0;
-		long min_volume, max_volume;
-		long out_volume_left, out_volume_right;
+		std::string conf;
+		if (!fs::read_file(PACMAN_CONF, conf))
+			return repos;
 
-		snd_mixer_selem_get_capture_volume_range(mic_element, &min_volume, &max_volume);
-		
-		if (snd_mixer_selem_get_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_LEFT, &out_volume_left) < 0)
+		text::scanner lines(conf);
+		for (std::string line; lines.next_line(line);)
 		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to get volume of mic element in left chanel");
-		}
+			const size_t open = line.find_first_not_of(" \t");
+			if (open == std::string::npos || line[open] != '[')
+				continue;
 
-		if (snd_mixer_selem_get_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_RIGHT, &out_volume_right) < 0)
-		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to get volume of mic element in rigth chanel");
-		}
+			const size_t close = line.find(']', open);
+			if (close == std::string::npos)
+				continue;
 
-		if (snd_mixer_selem_get_capture_switch(mic_element, SND_MIXER_SCHN_FRONT_LEFT, &is_active_left) < 0)
-		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to get switch status of mic element in left chanel");
+			const std::string section = line.substr(open + 1, close - open - 1);
+			if (section != "options")
+				repos.push_back(section);
 		}
 
-		if (snd_mixer_selem_get_capture_switch(mic_element, SND_MIXER_SCHN_FRONT_RIGHT, &is_active_right) < 0)
+		return repos;
+	}
+
+	std::time_t get_mtime(const std::string& path)
+	{
+		struct stat file_info;
+		return stat(path.c_str(), &file_info) ? 0 : file_info.st_mtime;
+	}
+
+	// Background job, rebuilds only databases whose mtime changed
+	void worker()
+	{
+		std::vector<db_index> dbs;
+		std::vector<std::pair<std::string, std::string>> installed;
+		std::time_t local_mtime = 0;
+
+		while (app_is_running)
 		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to get switch status of mic element in rigth chanel");
-		}
+			bool changed = false;
+
+			std::vector<std::string> db_paths;
+			fs::for_each_entry(PACMAN_SYNC_DIR, [&db_paths](const char* entry, unsigned char) {
+				const std::string name(entry);
+				if (name.size() > 3 && name.compare(name.size() - 3, 3, DB_SUFFIX) == 0)
+					db_paths.push_back(PACMAN_SYNC_DIR + name);
+			});
+
+			// Forget databases removed from sync dir
+			const size_t known = dbs.size();
+			dbs.erase(std::remove_if(dbs.begin(), dbs.end(), [&db_paths](const db_index& db) {
+				return std::find(db_paths.begin(), db_paths.end(), db.path) == db_paths.end();
+			}), dbs.end());
+			changed = dbs.size() != known;
+
+			for (const std::string& path : db_paths)
+			{
+				const std::time_t mtime = get_mtime(path);
 
-		// Calculate real maximum volume
-		max_volume -= min_volume;
+				auto cached = std::find_if(dbs.begin(), dbs.end(), [&path](const db_index& db) { return db.path == path; });
+				if (cached != dbs.end() && cached->mtime == mtime)
+					continue;
 
-		// Adjust to minimum bound
-		out_volume_left -= min_volume;
-		out_volume_right -= min_volume;
+				if (cached == dbs.end())
+					cached = dbs.insert(dbs.end(), db_index{ path });
 
-		// Adjust to 100% scale
-		out_volume_left = 100 * (out_volume_left) / max_volume;
-		out_volume_right = 100 * (out_volume_right) / max_volume;
+				// Undecodable databases stay empty until they change again
+				cached->mtime = mtime;
+				if (!build_index(path, *cached))
+					cached->packages.clear();
 
-		// Return max of two chanel
-		return {std::max(out_volume_left, out_volume_right), (bool(is_active_left) || bool(is_active_right))};
-	}
+				changed = true;
+			}
 
-	void set_mic(long in_volume)
-	{
-		snd_mixer_handle_events(mic_handle);
+			// First database in pacman.conf order providing a package wins, unlisted ones go last by name
+			const std::vector<std::string> repos = read_repo_order();
+			auto rank = [&repos](const db_index& db) {
+				const size_t prefix = std::strlen(PACMAN_SYNC_DIR);
+				const std::string repo = db.path.substr(prefix, db.path.size() - prefix - std::strlen(DB_SUFFIX));
+				return std::make_pair(std::find(repos.begin(), repos.end(), repo) - repos.begin(), db.path);
+			};
 
-		long min_volume, max_volume;
+			std::vector<std::string> previous_order;
+			for (const db_index& db : dbs)
+				previous_order.push_back(db.path);
 
-		snd_mixer_selem_get_capture_volume_range(mic_element, &min_volume, &max_volume);
+			std::sort(dbs.begin(), dbs.end(), [&rank](const db_index& a, const db_index& b) { return rank(a) < rank(b); });
 
-		// Checks for volume bounds
-		if (in_volume < 0 || in_volume > 100)
-			LOG_ERROR("Trying to set volume out of bounds");
+			// A reordered pacman.conf changes which version counts
+			for (size_t i = 0; i < dbs.size() && !changed; ++i)
+				changed = dbs[i].path != previous_order[i];
 
-		// Adjust volume to perform set operation
-		in_volume = (in_volume * (max_volume - min_volume) / (99)) + min_volume;
+			// Installs and upgrades rename entries of local dir
+			const std::time_t mtime = get_mtime(PACMAN_LOCAL_DIR);
+			if (mtime != local_mtime)
+			{
+				local_mtime = mtime;
+				installed = scan_local();
+				changed = true;
+			}
 
-		// Set in left and right channel
-		if (snd_mixer_selem_set_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_LEFT, in_volume) < 0)
-		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to set volume of mic element in left chanel");
-		}
+			if (changed)
+				pending = count_outdated(dbs, installed);
 
-		if (snd_mixer_selem_set_capture_volume(mic_element, SND_MIXER_SCHN_FRONT_RIGHT, in_volume) < 0)
-		{
-			snd_mixer_close(mic_handle);
-			LOG_ERROR("Failed to set volume of mic element in rigth chanel");
+			std::this_thread::sleep_for(REFRESH_INTERVAL);
 		}
 	}
 
-	status get_vol()
+	void init_updates()
 	{
-		snd_mixer_handle_events(volume_handle);
+		std::thread(worker).detach();
+	}
 
-		int is_active_right, is_active_left = 0;
-		long min_volume, max_volume;
-		long out_volume_left, out_volume_right;
+	int get_pending_updates()
+	{
+		int count = pending;
+		capture::values("updates:pending", count);
+		return count;
+	}
+}
 
-		snd_mixer_selem_get_playback_volume_range(volume_element, &min_volume, &max_volume);
-		
-		if (snd_mixer_selem_get_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_LEFT, &out_volume_left) < 0)
-		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to get volume of sound element in left chanel");
-		}
+//
+//	Hardware discovery cache
+//
+namespace hwcache
+{
+	// Constants
+	const char* BOOT_ID_PATH = "/proc/sys/kernel/random/boot_id";
+	const char* CACHE_NAME = "/task-bar.hwcache";
+
+	std::string cache_path;
+	std::string boot_id;
+
+	// What the last run found, only filled when it ran in this same boot
+	bool valid = false;
+	std::vector<std::pair<int, std::string>> batteries;
+	std::string sensor_chip;
+	int sensor_subfeature = -1;
 
-		if (snd_mixer_selem_get_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_RIGHT, &out_volume_right) < 0)
+	// File content as loaded, save is skipped when nothing changed
+	std::string loaded;
+
+	/**
+	 * @brief reads the cache, entries of another boot are dropped
+	 * @return bool true when the cache belongs to the current boot
+	 */
+	bool load()
+	{
+		// Only the private runtime dir is trusted, a shared /tmp could hand us anyone's file
+		const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+		if (!runtime_dir)
 		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to get volume of sound element in rigth chanel");
+			LOG_INFO("XDG_RUNTIME_DIR unset, hardware cache disabled");
+			return false;
 		}
+		cache_path = std::string(runtime_dir) + CACHE_NAME;
+
+		std::string boot_file;
+		if (!fs::read_file(BOOT_ID_PATH, boot_file))
+			return false;
+
+		text::scanner boot(boot_file);
+		if (!boot.next_word(boot_id))
+			return false;
+
+		if (!fs::read_file(cache_path.c_str(), loaded))
+			return false;
 
-		if (snd_mixer_selem_get_playback_switch(volume_element, SND_MIXER_SCHN_FRONT_RIGHT, &is_active_right) < 0)
+		text::scanner cache(loaded);
+		for (std::string line; cache.next_line(line);)
 		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to get switch state of sound element in rigth chanel");
+			text::scanner fields(line);
+			std::string key;
+			uint64_t number = 0;
+			fields.next_word(key);
+
+			if (key == "boot")
+			{
+				std::string id;
+				if (!fields.next_word(id) || id != boot_id)
+				{
+					LOG_INFO("Hardware cache is from another boot, discovering again");
+					break;
+				}
+				valid = true;
+			}
+			else if (key == "battery" && fields.next_u64(number))
+			{
+				std::string dir;
+				if (fields.next_word(dir))
+					batteries.push_back({ int(number), dir });
+			}
+			else if (key == "sensor" && fields.next_u64(number))
+			{
+				sensor_subfeature = int(number);
+				fields.next_word(sensor_chip);
+			}
 		}
-		
-		if (snd_mixer_selem_get_playback_switch(volume_element, SND_MIXER_SCHN_FRONT_LEFT, &is_active_left) < 0)
+
+		if (!valid)
 		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to get switch state of sound element in rigth chanel");
+			batteries.clear();
+			sensor_chip.clear();
 		}
 
-		// Calculate real maximum volume
-		max_volume -= min_volume;
-
-		// Adjust to minimum bound
-		out_volume_left -= min_volume;
-		out_volume_right -= min_volume;
-
-		// Adjust to 100% scale
-		out_volume_left = 100 * (out_volume_left) / max_volume;
-		out_volume_right = 100 * (out_volume_right) / max_volume;
-
-		// Return max of two chanel
-		return status{std::max(out_volume_left, out_volume_right), (bool(is_active_left) || bool(is_active_right))};
+		return valid;
 	}
 
-	void set_vol(long in_volume)
+	/**
+	 * @brief writes what modules ended up using, a no-op when it matches the loaded cache
+	 */
+	void save()
 	{
-		snd_mixer_handle_events(volume_handle);
+		if (cache_path.empty() || boot_id.empty())
+			return;
 
-		long min_volume, max_volume;
+		std::string content = "boot " + boot_id + "\n";
 
-		snd_mixer_selem_get_playback_volume_range(volume_element, &min_volume, &max_volume);
+		for (const auto& [ index, paths ] : battery::batteries)
+		{
+			const std::string& capacity = paths.at(0);
+			content += "battery " + std::to_string(index) + " " + capacity.substr(0, capacity.rfind('/')) + "\n";
+		}
 
-		// Checks for volume bounds
-		if (in_volume < 0 || in_volume > 100)
-			LOG_ERROR("Trying to set volume out of bounds");
+		const std::string chip = temp::chip_name();
+		if (!chip.empty())
+			content += "sensor " + std::to_string(temp::cpu_subfeature_number) + " " + chip + "\n";
 
-		// Adjust volume to perform set operation
-		in_volume = (in_volume * (max_volume - min_volume) / (99)) + min_volume;
+		if (content == loaded)
+			return;
 
-		// Set in left and right channel
-		if (snd_mixer_selem_set_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_LEFT, in_volume) < 0)
+		// Written aside and renamed over, a concurrent load never sees half a file
+		const std::string temp_path = cache_path + "." + std::to_string(getpid());
+		const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+		if (fd < 0)
 		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to set volume of sound element in left chanel");
+			LOG_WARN("Failed to write hardware cache: %", temp_path);
+			return;
 		}
 
-		if (snd_mixer_selem_set_playback_volume(volume_element, SND_MIXER_SCHN_FRONT_RIGHT, in_volume) < 0)
+		text::writer file{ fd };
+		file << content;
+		file.flush();
+		close(fd);
+
+		if (rename(temp_path.c_str(), cache_path.c_str()) != 0)
 		{
-			snd_mixer_close(volume_handle);
-			LOG_ERROR("Failed to set volume of sound element in rigth chanel");
+			LOG_WARN("Failed to replace hardware cache: %", cache_path);
+			unlink(temp_path.c_str());
 		}
 	}
 }
 
-//
-//	DATE Metrics
-//
-namespace date
+/**
+ * @brief prints resident memory of the process, for footprint comparison
+ */
+void report_rss()
 {
-	std::string get_formated_date()
-	{
-		auto time_shot = time(0);
-
-		tm* local_time_shot = localtime(&time_shot);
+	std::string status;
+	fs::read_file("/proc/self/status", status);
 
-		std::stringstream time_ss;
-
-		time_ss << std::put_time(local_time_shot, "%Y-%m-%d %H:%M:%S");
-
-		return time_ss.str();
+	text::scanner proc_status(status);
+	for (std::string word; proc_status.next_word(word);)
+	{
+		uint64_t rss;
+		if (word == "VmRSS:" && proc_status.next_u64(rss))
+		{
+			text::err << "rss: " << rss << " kB\n";
+			text::err.flush();
+			return;
+		}
 	}
 }
 
-//
-//	NET Metrics
-//
-
-//
-//	AUR Metrics
-//
-namespace AUR
+int main(int argc, char **argv)
 {
-	const std::string PACMAN_LOG_PATH = "/var/log/pacman.log";
-	#include <sys/stat.h>
+	// const wchar_t* a = L"⡀⡄⡆⡇";
 
+	// Usage: main [--record <log> | --replay <log> [--realtime]] [--uring] [--bench-collect <ticks>] [--frames <n>]
+	//             [--cgroup <self | path>]... [--control <fifo>]
+	// Replays use the --cgroup groups of the recording, the command line ones are ignored
+	// Bars running side by side (one per output or seat) need one --control FIFO each,
+	// without it the second one falls back to $XDG_RUNTIME_DIR/task-bar.<pid>.ctl.
+	// Without XDG_RUNTIME_DIR there is no default FIFO, only an explicit --control
+	const char* record_path = nullptr;
+	const char* replay_path = nullptr;
+	bool try_uring = false;
+	size_t bench_ticks = 0;
+	size_t max_frames = 0;
+	std::vector<std::string> cgroup_paths;
+	const char* control_path = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--record" && i + 1 < argc)
+			record_path = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			replay_path = argv[++i];
+		else if (arg == "--realtime")
+			capture::realtime = true;
+		else if (arg == "--uring")
+			try_uring = true;
+		else if (arg == "--bench-collect" && i + 1 < argc)
+			bench_ticks = std::stoul(argv[++i]);
+		else if (arg == "--frames" && i + 1 < argc)
+			max_frames = std::stoul(argv[++i]);
+		else if (arg == "--cgroup" && i + 1 < argc)
+			cgroup_paths.push_back(argv[++i]);
+		else if (arg == "--control" && i + 1 < argc)
+			control_path = argv[++i];
+	}
 
-	/**
-	 * @brief converts pacman time string to time_t
-	 * @param std::string string with format [yyyy-mm-ddxhh:mm:ss-xxxx] ....
-	 * @return std::time_t 
-	 */
-	std::time_t str2time_t(std::string string)
+	if (record_path && !capture::start_record(record_path))
 	{
-		struct tm  tm;
-		time_t rawtime;
-		time(&rawtime);
-		tm = *localtime(&rawtime);
-		tm.tm_year = stoi(string.substr(1, 4)) - 1900;
-		tm.tm_mon = stoi(string.substr(6, 2)) - 1;
-		tm.tm_mday = stoi(string.substr(9, 2));
-		tm.tm_hour = stoi(string.substr(12, 2));
-		tm.tm_min = stoi(string.substr(15, 2));
-		tm.tm_sec =  stoi(string.substr(18, 2));
-		return mktime(&tm);
+		text::err << "Failed to open record log: " << record_path << '\n';
+		text::err.flush();
+		return 1;
 	}
 
-	/**
-	 * @brief converts time in seconds to string
-	 * @param double time in seconds
-	 * @return std::string with format mm-dd hh:mm
-	 */
-	std::string sec2str(double time)
+	if (replay_path && !capture::start_replay(replay_path))
 	{
-		std::stringstream time_ss;
+		text::err << "Failed to open replay log: " << replay_path << '\n';
+		text::err.flush();
+		return 1;
+	}
 
-		unsigned int months = time/(30 * 24 * 60 * 60);
-		time = time - months * (30 * 24 * 60 * 60);
-		unsigned int days = time / (24 * 60 * 60);
-		time = time - days * (24 * 60 * 60);
-		unsigned int hours = time / (60 * 60);
-		time = time - hours * (60 * 60);
-		unsigned int mins = time / 60;
-		time_ss << "m:" << months <<" d:"<< days << " h:" << hours;
+	// Replays read what the recording did, so they take its groups over the command line
+	capture::option("cgroup", cgroup_paths);
 
-		return time_ss.str();
-	}
+	// Discovery of this boot is reused, recordings walk the hardware so replays see the same listings
+	const bool use_hwcache = !capture::replaying() && !record_path && hwcache::load();
 
-	std::time_t get_last_log_write()
+	if (!use_hwcache || !battery::restore_supplies(hwcache::batteries))
 	{
-		struct stat fileInfo;
-		if(stat(PACMAN_LOG_PATH.c_str(), &fileInfo))
-		{
-			std::cerr << "Error getting log metadata" << std::endl;
-			return 0;
-		}
-      	return fileInfo.st_mtime;      // Last mod time
+		if (battery::has_battery())
+			battery::check_supplies();
 	}
 
-	std::string get_last_update_date()
+	// Replayed values come from the log, no hardware to talk to
+	if (!capture::replaying())
 	{
+		temp::init_sensors(hwcache::sensor_chip, hwcache::sensor_subfeature);
 
-		static std::time_t last_log_write = 0;
-		static std::string last_pacman_update = "[1970-01-01T00:00:00-0300]";
-		
-		const std::string SYSTEM_UPGRADE_STR("[yyyy-mm-ddxhh:mm:ss-xxxx] [PACMAN] starting full system upgrade");
+		audio::init_mic_connections();
+		audio::init_volume_connections();
 
-		if (get_last_log_write() > last_log_write)
-		{
-			std::ifstream pacman_log(PACMAN_LOG_PATH);
-			std::cout << "update!\n";
-			last_log_write = get_last_log_write();
-			
-			for (std::string line; std::getline(pacman_log, line);)
-			{
-				if (line.size() == SYSTEM_UPGRADE_STR.size())
-				{
-					std::cout << line << "\n";
-					if (line.substr(39) == SYSTEM_UPGRADE_STR.substr(39))
-						last_pacman_update = line;
-				}
-			}
-			pacman_log.close();
-		}
+		if (!record_path)
+			hwcache::save();
 
-		//convert to string and get diference between time now and last update
-		double diff_time = difftime(time(0), str2time_t(last_pacman_update));
-		
-		return sec2str(diff_time);
+		control::init_control(control_path);
+
+		updates::init_updates();
 	}
-}
 
-int main(int argc, char **argv)
-{
-	// const wchar_t* a = L"⡀⡄⡆⡇";
+	pressure::init_pressure();
+
+	for (const std::string& path : cgroup_paths)
+		cgroup::add_group(path);
+
+	// Per-frame inputs are read in one batch each tick
+	if (!capture::replaying())
+	{
+		// The benchmark compares both backends
+		collect::init_collect(try_uring || bench_ticks);
 
-	if (battery::has_battery())
-		battery::check_supplies();
+		collect::watch("/proc/stat");
+		collect::watch("/proc/meminfo");
 
-	temp::init_sensors();
+		for (const auto& [ index, paths ] : battery::batteries)
+			for (const std::string& path : paths)
+				collect::watch(path);
 
-	audio::init_mic_connections();
-	audio::init_volume_connections();
+		for (const pressure::source& src : pressure::sources)
+			collect::watch(src.path);
+
+		for (const cgroup::group& g : cgroup::groups)
+			for (const char* file : cgroup::FILES)
+				collect::watch(g.dir + file);
+	}
+
+	if (bench_ticks)
+	{
+		collect::benchmark(bench_ticks);
+		return 0;
+	}
 
 	// Main loop
 	while (app_is_running)
 	{
-		std::cout << std::fixed;
-		std::cout << std::setprecision(1);
-		std::cout << " " << AUR::get_last_update_date();
-		std::cout << " |  " << cpu::get_cpu_metrics() << "%";
-		std::cout << " |  " << temp::get_cpu_temperature_metrics() << " ºC" ;
-		auto [ used, total, percent ] = ram::get_ram_metrics();
-		std::cout << " |   " << used << " / " << total << " (" << percent << "%)";
+		collect::tick();
+		control::apply();
+
+		text::out << " " << AUR::get_last_update_date();
+		const int pending_updates = updates::get_pending_updates();
+		text::out << " | upd " << (pending_updates < 0 ? "?" : std::to_string(pending_updates));
+		// Cgroup mode replaces host wide cpu and ram usage
+		if (cgroup::groups.empty())
+			text::out << " |  " << cpu::get_cpu_metrics() << "%";
+		text::out << " |  " << temp::get_cpu_temperature_metrics() << " ºC" ;
+		if (cgroup::groups.empty())
+		{
+			auto [ used, total, percent ] = ram::get_ram_metrics();
+			text::out << " |   " << used << " / " << total << " (" << percent << "%)";
+		}
+		for (const cgroup::status& group : cgroup::get_cgroup_metrics())
+		{
+			text::out << " | " << group.name << " cpu " << group.cpu_percent << "%";
+			text::out << " mem " << group.mem_used;
+			if (group.mem_max > 0)
+				text::out << " / " << group.mem_max;
+			text::out << " io " << group.io_read << "/" << group.io_write << " MB/s";
+		}
+		for (const auto& [ name, some, full, stalling ] : pressure::get_pressure_metrics())
+			text::out << " | " << name << (stalling ? "! " : " ") << some << "/" << full;
 		auto [capacity, charging, remaining_time] = battery::get_battery_metrics();
-		std::cout << " | " << (charging ? "\uf1e6 " : "\uf240 ") << capacity << "%"
+		text::out << " | " << (charging ? "\uf1e6 " : "\uf240 ") << capacity << "%"
 				  << "(" << remaining_time << ")";
-		std::cout << " | " << date::get_formated_date();
-		auto [ volume, vol_is_active] = audio::get_vol();
-		std::cout << " |"<< (vol_is_active ? "  " : " 婢 ") << volume << "%";
-		auto [ mic, mic_is_active] = audio::get_mic();
-		std::cout << " |"<< (mic_is_active ? "" : "") << mic << "%";
-		std::cout << std::endl;
+		text::out << " | " << date::get_formated_date();
+		auto [ volume, vol_is_active] = control::shown(control::VOLUME, audio::get_vol());
+		text::out << " |"<< (vol_is_active ? "  " : " 婢 ") << volume << "%";
+		auto [ mic, mic_is_active] = control::shown(control::MIC, audio::get_mic());
+		text::out << " |"<< (mic_is_active ? "" : "") << mic << "%";
+		text::out << '\n';
+		text::out.flush();
 		// for (int i = 50; i < 100; ++i)
 		// {
 		// 	audio::set_vol(i);
@@ -862,8 +3215,24 @@ int main(int argc, char **argv)
 		// 	std::cout << "Volume: " << audio::get_vol() << std::endl;
 		// 	std::cout << "Mic Volume: " << audio::get_mic() << std::endl;
 		// }
-		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		// Bounded runs stop right after their last frame, closed first so a recording keeps it
+		if (max_frames && capture::frames + 1 >= max_frames)
+		{
+			capture::next_frame();
+			break;
+		}
+
+		events::wait(std::chrono::milliseconds(250));
+
+		app_is_running = capture::next_frame();
 	}
 
+	capture::report();
+	control::close_control();
+
+	if (max_frames)
+		report_rss();
+
 	return 0;
 }